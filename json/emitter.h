@@ -0,0 +1,88 @@
+// Copyright 2020 Baptiste Lepilleur and The JsonCpp Authors
+// Distributed under MIT license, or public domain if desired and
+// recognized in your jurisdiction.
+// See file LICENSE for detail or copy at http://jsoncpp.sourceforge.net/LICENSE
+
+#ifndef JSON_EMITTER_H_INCLUDED
+#define JSON_EMITTER_H_INCLUDED
+
+#if !defined(JSON_IS_AMALGAMATION)
+#include "value.h"
+#endif // if !defined(JSON_IS_AMALGAMATION)
+#include <cstddef>
+#include <vector>
+
+#pragma pack(push, 8)
+
+namespace Json {
+
+/** \brief Destination of the text produced by an Emitter.
+ *
+ * Emitter hands over every token as soon as it is complete, so
+ * implementations are expected to buffer.
+ */
+class JSON_API EmitterSink {
+public:
+  virtual ~EmitterSink();
+  virtual void write(const char* text, size_t length) = 0;
+};
+
+/** \brief Writes compact JSON one token at a time, without building a Value.
+ *
+ * Usage:
+ *  \code
+ *  Json::Emitter emitter(sink);
+ *  emitter.beginObject();
+ *  emitter.key("total").number(1628.89);
+ *  emitter.key("years").beginArray().integer(1).integer(2).endArray();
+ *  emitter.endObject();
+ *  \endcode
+ *
+ * Memory use depends only on nesting depth. Calls that would produce
+ * invalid JSON (a value without a key inside an object, a key outside one,
+ * mismatched ends, a second root value) throw LogicError. Non-finite
+ * numbers have no JSON form and are written as null. Doubles are written
+ * in the shortest form that reads back as the same value.
+ */
+class JSON_API Emitter {
+public:
+  explicit Emitter(EmitterSink& sink);
+
+  Emitter& beginObject();
+  Emitter& endObject();
+  Emitter& beginArray();
+  Emitter& endArray();
+  Emitter& key(const char* name, size_t length);
+  Emitter& key(const char* name);
+  Emitter& key(const String& name);
+  Emitter& number(double value);
+  Emitter& integer(LargestInt value);
+  Emitter& unsignedInteger(LargestUInt value);
+  Emitter& boolean(bool value);
+  Emitter& null();
+  Emitter& string(const char* text, size_t length);
+  Emitter& string(const char* text);
+  Emitter& string(const String& text);
+
+  /// True once the root value has been closed.
+  bool complete() const;
+  /// Number of objects and arrays currently open.
+  size_t depth() const;
+
+private:
+  void beforeValue();
+  void afterValue();
+  void writeQuoted(const char* text, size_t length);
+
+  EmitterSink& sink_;
+  std::vector<char> scopes_;
+  bool needComma_;
+  bool afterKey_;
+  bool complete_;
+};
+
+} // namespace Json
+
+#pragma pack(pop)
+
+#endif // JSON_EMITTER_H_INCLUDED
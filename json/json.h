@@ -7,6 +7,7 @@
 #define JSON_JSON_H_INCLUDED
 
 #include "config.h"
+#include "emitter.h"
 #include "json_features.h"
 #include "reader.h"
 #include "value.h"
@@ -0,0 +1,262 @@
+// Copyright 2020 Baptiste Lepilleur and The JsonCpp Authors
+// Distributed under MIT license, or public domain if desired and
+// recognized in your jurisdiction.
+// See file LICENSE for detail or copy at http://jsoncpp.sourceforge.net/LICENSE
+
+#if !defined(JSON_IS_AMALGAMATION)
+#include "emitter.h"
+#endif // if !defined(JSON_IS_AMALGAMATION)
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+#if __cplusplus >= 201703L && defined(__has_include)
+#if __has_include(<charconv>)
+#include <charconv>
+#endif
+#endif
+
+namespace Json {
+
+namespace {
+
+// Enough for any shortest or %.17g double and any 64 bit integer.
+const size_t numberBufferSize = 32;
+
+size_t formatDouble(char* buffer, double value) {
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+  return static_cast<size_t>(
+      std::to_chars(buffer, buffer + numberBufferSize, value).ptr - buffer);
+#else
+  int length = snprintf(buffer, numberBufferSize, "%.17g", value);
+  // Undo a locale decimal comma.
+  for (int i = 0; i < length; ++i) {
+    if (buffer[i] == ',')
+      buffer[i] = '.';
+  }
+  return static_cast<size_t>(length);
+#endif
+}
+
+// Writes digits backwards from the end of the buffer.
+char* formatUnsigned(char* end, LargestUInt value) {
+  do {
+    *--end = static_cast<char>('0' + value % 10);
+    value /= 10;
+  } while (value != 0);
+  return end;
+}
+
+} // namespace
+
+EmitterSink::~EmitterSink() = default;
+
+Emitter::Emitter(EmitterSink& sink)
+    : sink_(sink), needComma_(false), afterKey_(false), complete_(false) {}
+
+void Emitter::beforeValue() {
+  if (scopes_.empty()) {
+    if (complete_)
+      throwLogicError("Json::Emitter: the root value is already complete");
+    return;
+  }
+  if (scopes_.back() == '{') {
+    if (!afterKey_)
+      throwLogicError("Json::Emitter: object member needs a key");
+    return;
+  }
+  if (needComma_)
+    sink_.write(",", 1);
+}
+
+void Emitter::afterValue() {
+  afterKey_ = false;
+  if (scopes_.empty())
+    complete_ = true;
+  else
+    needComma_ = true;
+}
+
+void Emitter::writeQuoted(const char* text, size_t length) {
+  static const char hexDigits[] = "0123456789abcdef";
+  sink_.write("\"", 1);
+  // Runs of characters that need no escaping go out in one write.
+  size_t runStart = 0;
+  for (size_t i = 0; i < length; ++i) {
+    unsigned char c = static_cast<unsigned char>(text[i]);
+    if (c >= 0x20 && c != '"' && c != '\\')
+      continue;
+    if (i > runStart)
+      sink_.write(text + runStart, i - runStart);
+    runStart = i + 1;
+    char escape[6] = {'\\', 0, 0, 0, 0, 0};
+    size_t escapeLength = 2;
+    switch (c) {
+    case '"':
+      escape[1] = '"';
+      break;
+    case '\\':
+      escape[1] = '\\';
+      break;
+    case '\b':
+      escape[1] = 'b';
+      break;
+    case '\f':
+      escape[1] = 'f';
+      break;
+    case '\n':
+      escape[1] = 'n';
+      break;
+    case '\r':
+      escape[1] = 'r';
+      break;
+    case '\t':
+      escape[1] = 't';
+      break;
+    default:
+      escape[1] = 'u';
+      escape[2] = '0';
+      escape[3] = '0';
+      escape[4] = hexDigits[c >> 4];
+      escape[5] = hexDigits[c & 0xf];
+      escapeLength = 6;
+      break;
+    }
+    sink_.write(escape, escapeLength);
+  }
+  if (length > runStart)
+    sink_.write(text + runStart, length - runStart);
+  sink_.write("\"", 1);
+}
+
+Emitter& Emitter::beginObject() {
+  beforeValue();
+  sink_.write("{", 1);
+  scopes_.push_back('{');
+  needComma_ = false;
+  afterKey_ = false;
+  return *this;
+}
+
+Emitter& Emitter::endObject() {
+  if (scopes_.empty() || scopes_.back() != '{')
+    throwLogicError("Json::Emitter: endObject without an open object");
+  if (afterKey_)
+    throwLogicError("Json::Emitter: key without a value");
+  sink_.write("}", 1);
+  scopes_.pop_back();
+  afterValue();
+  return *this;
+}
+
+Emitter& Emitter::beginArray() {
+  beforeValue();
+  sink_.write("[", 1);
+  scopes_.push_back('[');
+  needComma_ = false;
+  afterKey_ = false;
+  return *this;
+}
+
+Emitter& Emitter::endArray() {
+  if (scopes_.empty() || scopes_.back() != '[')
+    throwLogicError("Json::Emitter: endArray without an open array");
+  sink_.write("]", 1);
+  scopes_.pop_back();
+  afterValue();
+  return *this;
+}
+
+Emitter& Emitter::key(const char* name, size_t length) {
+  if (scopes_.empty() || scopes_.back() != '{')
+    throwLogicError("Json::Emitter: key outside an object");
+  if (afterKey_)
+    throwLogicError("Json::Emitter: key without a value");
+  if (needComma_)
+    sink_.write(",", 1);
+  writeQuoted(name, length);
+  sink_.write(":", 1);
+  afterKey_ = true;
+  return *this;
+}
+
+Emitter& Emitter::key(const char* name) {
+  return key(name, strlen(name));
+}
+
+Emitter& Emitter::key(const String& name) {
+  return key(name.data(), name.length());
+}
+
+Emitter& Emitter::number(double value) {
+  if (!std::isfinite(value))
+    return null();
+  beforeValue();
+  char buffer[numberBufferSize];
+  sink_.write(buffer, formatDouble(buffer, value));
+  afterValue();
+  return *this;
+}
+
+Emitter& Emitter::integer(LargestInt value) {
+  beforeValue();
+  char buffer[numberBufferSize];
+  char* end = buffer + numberBufferSize;
+  // Negate in unsigned arithmetic so the most negative value works too.
+  LargestUInt magnitude = value < 0 ? LargestUInt(0) - LargestUInt(value)
+                                    : LargestUInt(value);
+  char* start = formatUnsigned(end, magnitude);
+  if (value < 0)
+    *--start = '-';
+  sink_.write(start, static_cast<size_t>(end - start));
+  afterValue();
+  return *this;
+}
+
+Emitter& Emitter::unsignedInteger(LargestUInt value) {
+  beforeValue();
+  char buffer[numberBufferSize];
+  char* end = buffer + numberBufferSize;
+  char* start = formatUnsigned(end, value);
+  sink_.write(start, static_cast<size_t>(end - start));
+  afterValue();
+  return *this;
+}
+
+Emitter& Emitter::boolean(bool value) {
+  beforeValue();
+  if (value)
+    sink_.write("true", 4);
+  else
+    sink_.write("false", 5);
+  afterValue();
+  return *this;
+}
+
+Emitter& Emitter::null() {
+  beforeValue();
+  sink_.write("null", 4);
+  afterValue();
+  return *this;
+}
+
+Emitter& Emitter::string(const char* text, size_t length) {
+  beforeValue();
+  writeQuoted(text, length);
+  afterValue();
+  return *this;
+}
+
+Emitter& Emitter::string(const char* text) {
+  return string(text, strlen(text));
+}
+
+Emitter& Emitter::string(const String& text) {
+  return string(text.data(), text.length());
+}
+
+bool Emitter::complete() const { return complete_; }
+
+size_t Emitter::depth() const { return scopes_.size(); }
+
+} // namespace Json
@@ -0,0 +1,111 @@
+/**********************************************************************/
+/*! \file  AffineScan.cpp
+ * \author Seth Peterson
+ * \date   2020-09-20
+ * \brief
+ *     Every step of a projection is the affine map x -> r*x + c, and
+ *     affine maps compose associatively: (r2,c2) after (r1,c1) is
+ *     (r2*r1, r2*c1 + c2). That lets the steps be split into blocks that
+ *     are scanned independently and stitched together afterwards.
+ */
+/**********************************************************************/
+#include "AffineScan.h"
+#include "ThreadPool.h"
+#include <vector> //Scratch space for the block factors
+
+//Blocks shorter than this are not worth a thread handoff.
+static const unsigned MinimumBlockSteps = 256;
+
+/*! \brief
+ * Computes the running total after every step of a schedule.
+ *
+ * Pass one scans each block on its own from the identity map, leaving the
+ * block-local factor and offset for every step. A short serial pass then
+ * carries the starting capital across block boundaries, and pass two folds
+ * that starting value into every step with a plain multiply-add loop the
+ * compiler can vectorize.
+ * \param InitialCapital
+ * Investment held before the first step.
+ * \param Rates
+ * Growth multiplier for each step.
+ * \param Contributions
+ * Amount added at the end of each step.
+ * \param Steps
+ * Length of the Rates, Contributions and Totals arrays.
+ * \param Totals
+ * Receives the balance after each step.
+ * \param Pool
+ * Workers to spread the blocks over. Without one the scan runs serially.
+ */
+void ProjectSchedule(double InitialCapital, const double* Rates, const double* Contributions, unsigned Steps, double* Totals, ThreadPool* Pool)
+{
+  unsigned Blocks = 1;
+  if (Pool != nullptr)
+  {
+    Blocks = Steps / MinimumBlockSteps;
+    if (Blocks > Pool->Size())
+    {
+      Blocks = Pool->Size();
+    }
+  }
+
+  if (Blocks <= 1)
+  {
+    double Capital = InitialCapital;
+    for (unsigned i = 0; i < Steps; ++i)
+    {
+      Capital = Rates[i] * Capital + Contributions[i];
+      Totals[i] = Capital;
+    }
+    return;
+  }
+
+  unsigned BlockSteps = (Steps + Blocks - 1) / Blocks;
+  std::vector<double> Factors(Steps);
+  std::vector<double> BlockFactor(Blocks);
+  std::vector<double> BlockOffset(Blocks);
+
+  //Pass one: each block scans from the identity map. The first block
+  //already knows its starting capital, so its results are final.
+  Pool->Run(Blocks, [&](unsigned Block, unsigned)
+  {
+    unsigned Begin = Block * BlockSteps;
+    unsigned End = (Begin + BlockSteps < Steps) ? Begin + BlockSteps : Steps;
+    double Factor = 1.0;
+    double Offset = (Block == 0) ? InitialCapital : 0.0;
+    for (unsigned i = Begin; i < End; ++i)
+    {
+      Factor *= Rates[i];
+      Offset = Rates[i] * Offset + Contributions[i];
+      Factors[i] = Factor;
+      Totals[i] = Offset;
+    }
+    BlockFactor[Block] = Factor;
+    BlockOffset[Block] = Offset;
+  });
+
+  //Carry the capital across block boundaries.
+  std::vector<double> BlockStart(Blocks);
+  BlockStart[0] = InitialCapital;
+  double Carry = BlockOffset[0];
+  for (unsigned Block = 1; Block < Blocks; ++Block)
+  {
+    BlockStart[Block] = Carry;
+    Carry = BlockFactor[Block] * Carry + BlockOffset[Block];
+  }
+
+  //Pass two: fold each block's starting capital into its steps.
+  Pool->Run(Blocks - 1, [&](unsigned Task, unsigned)
+  {
+    unsigned Block = Task + 1;
+    unsigned Begin = Block * BlockSteps;
+    unsigned End = (Begin + BlockSteps < Steps) ? Begin + BlockSteps : Steps;
+    double Start = BlockStart[Block];
+    double* Total = Totals;
+    const double* Factor = Factors.data();
+    for (unsigned i = Begin; i < End; ++i)
+    {
+      Total[i] = Factor[i] * Start + Total[i];
+    }
+  });
+}
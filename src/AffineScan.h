@@ -0,0 +1,17 @@
+/**********************************************************************/
+/*! \file  AffineScan.h
+ * \author Seth Peterson
+ * \date   2020-09-20
+ * \brief
+ *     Projects an investment over a schedule of per-step rates and
+ *     contributions using a parallel prefix scan of affine maps.
+ */
+/**********************************************************************/
+#ifndef AFFINESCAN_H
+#define AFFINESCAN_H
+
+class ThreadPool;
+
+void ProjectSchedule(double InitialCapital, const double* Rates, const double* Contributions, unsigned Steps, double* Totals, ThreadPool* Pool = nullptr);
+
+#endif
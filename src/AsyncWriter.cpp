@@ -0,0 +1,118 @@
+/**********************************************************************/
+/*! \file  AsyncWriter.cpp
+ * \author Seth Peterson
+ * \date   2020-10-20
+ * \brief
+ *     Output stage on its own thread. Buffers are swapped, never copied:
+ *     Submit trades the producer's full buffer for a spare one, and the
+ *     writer thread puts each buffer back on the spare list once it has
+ *     been written.
+ */
+/**********************************************************************/
+#include "AsyncWriter.h"
+#include "OutputBuffer.h" //For WriteAll
+#include <stdexcept> //For a writer without buffers
+#include <system_error> //For failed writes
+
+/*! \brief
+ * Starts the writer thread.
+ * \param Buffers
+ * Spare buffers owned by the writer, at least one. Each is sized by the
+ * first buffer traded for it.
+ */
+AsyncWriter::AsyncWriter(size_t Buffers)
+{
+  if (Buffers == 0)
+  {
+    throw std::invalid_argument("Asynchronous writer needs at least one spare buffer.");
+  }
+  Spare_.resize(Buffers);
+  Writer_ = std::thread(&AsyncWriter::WriterLoop, this);
+}
+
+//Destructor writes everything still queued and joins the writer. Errors
+//are lost here; call Wait first to see them.
+AsyncWriter::~AsyncWriter()
+{
+  {
+    std::lock_guard<std::mutex> guard(Lock_);
+    Stopping_ = true;
+  }
+  Queued_.notify_all();
+  Writer_.join();
+}
+
+//Writes queued buffers until told to stop and nothing is left.
+void AsyncWriter::WriterLoop()
+{
+  std::unique_lock<std::mutex> lock(Lock_);
+  while (true)
+  {
+    Queued_.wait(lock, [this] { return Stopping_ || !Queue_.empty(); });
+    if (Queue_.empty())
+    {
+      return;
+    }
+    Job Next = std::move(Queue_.front());
+    Queue_.pop_front();
+    Writing_ = true;
+
+    lock.unlock();
+    int Error = WriteAll(Next.Descriptor, Next.Buffer.data(), Next.Used);
+    lock.lock();
+
+    Writing_ = false;
+    if (Error != 0 && Error_ == 0)
+    {
+      Error_ = Error;
+    }
+    Spare_.push_back(std::move(Next.Buffer));
+    Returned_.notify_all();
+  }
+}
+
+//Reports a failed write once. Called with Lock_ held.
+void AsyncWriter::ThrowError()
+{
+  if (Error_ != 0)
+  {
+    int Error = Error_;
+    Error_ = 0;
+    throw std::system_error(Error, std::generic_category(), "Could not write output");
+  }
+}
+
+/*! \brief
+ * Queues the first Used bytes of Buffer for Descriptor and replaces
+ * Buffer with an empty spare of at least the same size.
+ */
+void AsyncWriter::Submit(int Descriptor, std::vector<char>& Buffer, size_t Used)
+{
+  size_t Capacity = Buffer.size();
+  {
+    std::unique_lock<std::mutex> lock(Lock_);
+    ThrowError();
+    Returned_.wait(lock, [this] { return !Spare_.empty(); });
+    std::vector<char> Full;
+    Full.swap(Buffer);
+    Buffer.swap(Spare_.back());
+    Spare_.pop_back();
+    Queue_.push_back(Job{Descriptor, std::move(Full), Used});
+  }
+  Queued_.notify_one();
+  //Spares start empty and may come from a producer with smaller buffers.
+  if (Buffer.size() < Capacity)
+  {
+    Buffer.resize(Capacity);
+  }
+}
+
+/*! \brief
+ * Returns once everything submitted so far has been written.
+ */
+void AsyncWriter::Wait()
+{
+  std::unique_lock<std::mutex> lock(Lock_);
+  Returned_.wait(lock, [this] { return Queue_.empty() && !Writing_; });
+  ThrowError();
+}
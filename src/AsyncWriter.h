@@ -0,0 +1,62 @@
+/**********************************************************************/
+/*! \file  AsyncWriter.h
+ * \author Seth Peterson
+ * \date   2020-10-20
+ * \brief
+ *     Output stage on its own thread. OutputBuffers attached to an
+ *     AsyncWriter hand full buffers over instead of writing them, and get
+ *     an empty one back, so formatting and computing carry on while the
+ *     writer thread waits on a slow disk or pipe.
+ */
+/**********************************************************************/
+#ifndef ASYNCWRITER_H
+#define ASYNCWRITER_H
+
+#include <condition_variable> //For waking the writer and waiting on it
+#include <cstddef> //For size_t
+#include <deque> //Buffers waiting to be written
+#include <mutex> //Guards the queue and the spare buffers
+#include <thread> //Writer thread
+#include <vector> //Buffer storage
+
+/* Writes submitted buffers in submission order, each to its own file
+ * descriptor, on one background thread. Each producer keeps the buffer
+ * it is filling and the writer owns Buffers more, so the default of two
+ * gives triple buffering: one filling, one queued, one being written.
+ * When no spare buffer is left, Submit blocks until the writer frees
+ * one. A failed write is reported by the next Submit or Wait. */
+class AsyncWriter
+{
+  private:
+    struct Job
+    {
+      int Descriptor;
+      std::vector<char> Buffer;
+      size_t Used;
+    };
+
+    std::thread Writer_;
+    std::mutex Lock_;
+    std::condition_variable Queued_;
+    std::condition_variable Returned_;
+    std::deque<Job> Queue_;
+    std::vector<std::vector<char>> Spare_;
+    bool Writing_ = false;
+    bool Stopping_ = false;
+    int Error_ = 0;
+
+    void WriterLoop();
+    void ThrowError();
+
+  public:
+    AsyncWriter(size_t Buffers = 2);
+    ~AsyncWriter();
+
+    AsyncWriter(const AsyncWriter&) = delete;
+    AsyncWriter& operator=(const AsyncWriter&) = delete;
+
+    void Submit(int Descriptor, std::vector<char>& Buffer, size_t Used);
+    void Wait();
+};
+
+#endif
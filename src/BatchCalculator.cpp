@@ -0,0 +1,186 @@
+/**********************************************************************/
+/*! \file  BatchCalculator.cpp
+ * \author Seth Peterson
+ * \date   2020-09-22
+ * \brief
+ *     Structure-of-arrays batch projection. Each vector lane holds one
+ *     scenario; lanes that have reached their horizon are masked off
+ *     while the rest of the group keeps compounding. The vector kernels
+ *     use fused multiply-add, so their results can differ from the scalar
+ *     kernel in the last bit.
+ */
+/**********************************************************************/
+#include "BatchCalculator.h"
+#include "InvestmentCalculator.h" //For CalculateNextTotal
+#include <cstdint> //For INT32_MIN
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define BATCH_HAVE_X86_KERNELS 1
+#include <immintrin.h>
+#endif
+
+//Plain loop used for machines without vector support and for tails.
+static void ProjectBatchScalar(const double* Capital, const double* Rate, const double* Contribution, const unsigned* Years, size_t Count, double* FinalTotals)
+{
+  for (size_t i = 0; i < Count; ++i)
+  {
+    double Total = Capital[i];
+    for (unsigned Year = 0; Year < Years[i]; ++Year)
+    {
+      Total = CalculateNextTotal(Total, Rate[i], Contribution[i]);
+    }
+    FinalTotals[i] = Total;
+  }
+}
+
+//Longest horizon within a group of lanes.
+static unsigned MaxYears(const unsigned* Years, size_t Lanes)
+{
+  unsigned Longest = 0;
+  for (size_t i = 0; i < Lanes; ++i)
+  {
+    if (Years[i] > Longest)
+    {
+      Longest = Years[i];
+    }
+  }
+  return Longest;
+}
+
+#ifdef BATCH_HAVE_X86_KERNELS
+//Four scenarios per instruction.
+__attribute__((target("avx2,fma")))
+static void ProjectBatchAvx2(const double* Capital, const double* Rate, const double* Contribution, const unsigned* Years, size_t Count, double* FinalTotals)
+{
+  size_t i = 0;
+  for (; i + 4 <= Count; i += 4)
+  {
+    __m256d Total = _mm256_loadu_pd(Capital + i);
+    __m256d R = _mm256_loadu_pd(Rate + i);
+    __m256d C = _mm256_loadu_pd(Contribution + i);
+    //AVX2 only converts signed integers: flip the top bit so the value
+    //reads as Years - 2^31, convert, then add 2^31 back exactly.
+    __m128i Biased = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(Years + i)), _mm_set1_epi32(INT32_MIN));
+    __m256d Horizon = _mm256_add_pd(_mm256_cvtepi32_pd(Biased), _mm256_set1_pd(2147483648.0));
+    __m256d Year = _mm256_setzero_pd();
+    __m256d One = _mm256_set1_pd(1.0);
+
+    unsigned Longest = MaxYears(Years + i, 4);
+    for (unsigned y = 0; y < Longest; ++y)
+    {
+      __m256d Active = _mm256_cmp_pd(Year, Horizon, _CMP_LT_OQ);
+      __m256d Next = _mm256_fmadd_pd(R, Total, C);
+      Total = _mm256_blendv_pd(Total, Next, Active);
+      Year = _mm256_add_pd(Year, One);
+    }
+    _mm256_storeu_pd(FinalTotals + i, Total);
+  }
+  ProjectBatchScalar(Capital + i, Rate + i, Contribution + i, Years + i, Count - i, FinalTotals + i);
+}
+
+//Eight scenarios per instruction, with the horizon check in a mask register.
+__attribute__((target("avx512f")))
+static void ProjectBatchAvx512(const double* Capital, const double* Rate, const double* Contribution, const unsigned* Years, size_t Count, double* FinalTotals)
+{
+  size_t i = 0;
+  for (; i + 8 <= Count; i += 8)
+  {
+    __m512d Total = _mm512_loadu_pd(Capital + i);
+    __m512d R = _mm512_loadu_pd(Rate + i);
+    __m512d C = _mm512_loadu_pd(Contribution + i);
+    __m512d Horizon = _mm512_maskz_cvtepu32_pd(0xFF, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(Years + i)));
+    __m512d Year = _mm512_setzero_pd();
+    __m512d One = _mm512_set1_pd(1.0);
+
+    unsigned Longest = MaxYears(Years + i, 8);
+    for (unsigned y = 0; y < Longest; ++y)
+    {
+      __mmask8 Active = _mm512_cmp_pd_mask(Year, Horizon, _CMP_LT_OQ);
+      Total = _mm512_mask_fmadd_pd(Total, Active, R, C);
+      Year = _mm512_add_pd(Year, One);
+    }
+    _mm512_storeu_pd(FinalTotals + i, Total);
+  }
+  ProjectBatchAvx2(Capital + i, Rate + i, Contribution + i, Years + i, Count - i, FinalTotals + i);
+}
+#endif
+
+/*! \brief
+ * Picks the widest kernel the running CPU supports.
+ */
+BatchKernel SelectBatchKernel()
+{
+#ifdef BATCH_HAVE_X86_KERNELS
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f"))
+  {
+    return BatchKernel::Avx512;
+  }
+  if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+  {
+    return BatchKernel::Avx2;
+  }
+#endif
+  return BatchKernel::Scalar;
+}
+
+/*! \brief
+ * Human readable kernel name, useful for logging which path ran.
+ */
+const char* BatchKernelName(BatchKernel Kernel)
+{
+  switch (Kernel)
+  {
+    case BatchKernel::Avx512:
+      return "avx512";
+    case BatchKernel::Avx2:
+      return "avx2";
+    default:
+      return "scalar";
+  }
+}
+
+/*! \brief
+ * Projects every scenario in the batch with the best kernel for this CPU.
+ * \param Capital
+ * Initial capital column.
+ * \param Rate
+ * Growth multiplier column.
+ * \param Contribution
+ * Yearly contribution column.
+ * \param Years
+ * Horizon column. Mixed horizons are fine, lanes stop at their own year.
+ * \param Count
+ * Number of scenarios, the length of every column.
+ * \param FinalTotals
+ * Receives the balance of each scenario at the end of its horizon.
+ */
+void ProjectBatch(const double* Capital, const double* Rate, const double* Contribution, const unsigned* Years, size_t Count, double* FinalTotals)
+{
+  static const BatchKernel Best = SelectBatchKernel();
+  ProjectBatch(Capital, Rate, Contribution, Years, Count, FinalTotals, Best);
+}
+
+/*! \brief
+ * Projects every scenario in the batch with a specific kernel. Asking for
+ * a kernel the build does not include falls back to the scalar loop; the
+ * caller is responsible for not forcing one the CPU cannot execute.
+ */
+void ProjectBatch(const double* Capital, const double* Rate, const double* Contribution, const unsigned* Years, size_t Count, double* FinalTotals, BatchKernel Kernel)
+{
+#ifdef BATCH_HAVE_X86_KERNELS
+  if (Kernel == BatchKernel::Avx512)
+  {
+    ProjectBatchAvx512(Capital, Rate, Contribution, Years, Count, FinalTotals);
+    return;
+  }
+  if (Kernel == BatchKernel::Avx2)
+  {
+    ProjectBatchAvx2(Capital, Rate, Contribution, Years, Count, FinalTotals);
+    return;
+  }
+#else
+  (void)Kernel;
+#endif
+  ProjectBatchScalar(Capital, Rate, Contribution, Years, Count, FinalTotals);
+}
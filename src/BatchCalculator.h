@@ -0,0 +1,28 @@
+/**********************************************************************/
+/*! \file  BatchCalculator.h
+ * \author Seth Peterson
+ * \date   2020-09-22
+ * \brief
+ *     Projects many independent scenarios at once from column arrays,
+ *     using the widest vector instructions the machine supports.
+ */
+/**********************************************************************/
+#ifndef BATCHCALCULATOR_H
+#define BATCHCALCULATOR_H
+
+#include <cstddef> //For size_t
+
+enum class BatchKernel
+{
+  Scalar,
+  Avx2,
+  Avx512
+};
+
+BatchKernel SelectBatchKernel();
+const char* BatchKernelName(BatchKernel Kernel);
+
+void ProjectBatch(const double* Capital, const double* Rate, const double* Contribution, const unsigned* Years, size_t Count, double* FinalTotals);
+void ProjectBatch(const double* Capital, const double* Rate, const double* Contribution, const unsigned* Years, size_t Count, double* FinalTotals, BatchKernel Kernel);
+
+#endif
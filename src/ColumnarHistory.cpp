@@ -0,0 +1,385 @@
+/**********************************************************************/
+/*! \file  ColumnarHistory.cpp
+ * \author Seth Peterson
+ * \date   2020-10-19
+ * \brief
+ *     Columnar history files.
+ *
+ *     Layout, every section starting on a 64 byte boundary:
+ *       header   magic, version, column count, then one 32 byte schema
+ *                entry (name, type, width) per column
+ *       batches  64 byte batch header (rows, offset of each column from
+ *                the batch start), then each column's values
+ *       index    (offset, rows) of every batch
+ *       tail     index offset, batch count, magic
+ *     Values are stored in the machine's byte order, which must be little
+ *     endian like Arrow's.
+ */
+/**********************************************************************/
+#include "ColumnarHistory.h"
+#include "InvestmentData.h" //Rows to append
+#include <sys/mman.h> //For mmap and munmap
+#include <sys/stat.h> //For fstat
+#include <fcntl.h> //For open
+#include <unistd.h> //For close
+#include <cerrno> //For errno
+#include <cstring> //For memcpy, memcmp and strncpy
+#include <stdexcept> //For malformed files and misuse
+#include <system_error> //For failed system calls
+
+static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__, "Columnar files are little endian.");
+
+static const char ColumnarMagic[8] = {'I', 'C', 'C', 'O', 'L', 'S', '\0', '\0'};
+static const uint32_t ColumnarVersion = 1;
+static const uint64_t SectionAlignment = 64;
+static const int ColumnCount = 5;
+
+enum ColumnType : uint32_t
+{
+  UInt32Column = 1,
+  Int32Column = 2,
+  Float64Column = 3
+};
+
+struct SchemaEntry
+{
+  char Name[24];
+  uint32_t Type;
+  uint32_t Width;
+};
+
+struct FileHeader
+{
+  char Magic[8];
+  uint32_t Version;
+  uint32_t Columns;
+  char Padding[48];
+  SchemaEntry Schema[ColumnCount];
+  char SchemaPadding[32];
+};
+
+struct BatchHeader
+{
+  uint64_t Rows;
+  uint64_t ColumnOffsets[ColumnCount];
+  char Padding[16];
+};
+
+struct FileTail
+{
+  uint64_t IndexOffset;
+  uint64_t Batches;
+  char Magic[8];
+  uint64_t Reserved;
+};
+
+static_assert(sizeof(FileHeader) % SectionAlignment == 0, "Batches must start aligned.");
+static_assert(sizeof(BatchHeader) == SectionAlignment, "Columns must start aligned.");
+
+//The fixed schema, in column order.
+static const SchemaEntry Schema[ColumnCount] =
+{
+  {"scenario_id", UInt32Column, 4},
+  {"year", Int32Column, 4},
+  {"total", Float64Column, 8},
+  {"interest", Float64Column, 8},
+  {"contribution", Float64Column, 8}
+};
+
+static uint64_t AlignUp(uint64_t Offset)
+{
+  return (Offset + SectionAlignment - 1) / SectionAlignment * SectionAlignment;
+}
+
+/*! \brief
+ * Creates (or truncates) the file and writes its header.
+ * \param BatchRows
+ * Rows per record batch; bigger batches mean fewer, longer column runs.
+ */
+ColumnarHistoryWriter::ColumnarHistoryWriter(const std::string& Path, size_t BatchRows) :
+  Path_(Path), File_(Path, std::ios::binary | std::ios::trunc), BatchRows_(BatchRows)
+{
+  if (!File_)
+  {
+    throw std::runtime_error("Could not create columnar file " + Path);
+  }
+  if (BatchRows_ == 0)
+  {
+    throw std::invalid_argument("Record batches need at least one row.");
+  }
+  FileHeader Header = {};
+  std::memcpy(Header.Magic, ColumnarMagic, sizeof(ColumnarMagic));
+  Header.Version = ColumnarVersion;
+  Header.Columns = ColumnCount;
+  std::memcpy(Header.Schema, Schema, sizeof(Schema));
+  WriteBytes(&Header, sizeof(Header));
+
+  Scenarios_.reserve(BatchRows_);
+  Years_.reserve(BatchRows_);
+  Totals_.reserve(BatchRows_);
+  Interest_.reserve(BatchRows_);
+  Contributions_.reserve(BatchRows_);
+}
+
+//Destructor finishes the file if Close was not called. Errors are lost
+//here; call Close first to see them.
+ColumnarHistoryWriter::~ColumnarHistoryWriter()
+{
+  try
+  {
+    Close();
+  }
+  catch (...)
+  {
+  }
+}
+
+void ColumnarHistoryWriter::WriteBytes(const void* Bytes, size_t Size)
+{
+  File_.write(static_cast<const char*>(Bytes), Size);
+  Offset_ += Size;
+}
+
+//Zero fills up to the next section boundary.
+void ColumnarHistoryWriter::WritePadding()
+{
+  static const char Zeros[SectionAlignment] = {};
+  WriteBytes(Zeros, AlignUp(Offset_) - Offset_);
+}
+
+//Writes the pending rows as one record batch.
+void ColumnarHistoryWriter::WriteBatch()
+{
+  uint64_t Rows = Scenarios_.size();
+  if (Rows == 0)
+  {
+    return;
+  }
+  const void* Columns[ColumnCount] = {Scenarios_.data(), Years_.data(), Totals_.data(), Interest_.data(), Contributions_.data()};
+
+  BatchHeader Header = {};
+  Header.Rows = Rows;
+  uint64_t Column = sizeof(BatchHeader);
+  for (int i = 0; i < ColumnCount; ++i)
+  {
+    Header.ColumnOffsets[i] = Column;
+    Column = AlignUp(Column + Rows * Schema[i].Width);
+  }
+
+  Batches_.push_back(BatchEntry{Offset_, Rows});
+  WriteBytes(&Header, sizeof(Header));
+  for (int i = 0; i < ColumnCount; ++i)
+  {
+    WriteBytes(Columns[i], Rows * Schema[i].Width);
+    WritePadding();
+  }
+
+  Scenarios_.clear();
+  Years_.clear();
+  Totals_.clear();
+  Interest_.clear();
+  Contributions_.clear();
+}
+
+/*! \brief
+ * Adds one row, writing a batch when it fills.
+ */
+void ColumnarHistoryWriter::Append(uint32_t Scenario, int32_t Year, double Total, double Interest, double Contribution)
+{
+  if (!File_.is_open())
+  {
+    throw std::logic_error("Columnar file " + Path_ + " is already closed.");
+  }
+  Scenarios_.push_back(Scenario);
+  Years_.push_back(Year);
+  Totals_.push_back(Total);
+  Interest_.push_back(Interest);
+  Contributions_.push_back(Contribution);
+  if (Scenarios_.size() == BatchRows_)
+  {
+    WriteBatch();
+  }
+}
+
+/*! \brief
+ * Adds every row of a stored history as rows of one scenario, labelled
+ * with the years PrintContents shows.
+ */
+void ColumnarHistoryWriter::Append(uint32_t Scenario, InvestmentData& History)
+{
+  for (int i = 0; i < History.Size(); ++i)
+  {
+    Append(Scenario, History.YearAt(i), History.TotalAt(i), History.InterestAt(i), History.ContributionAt(i));
+  }
+}
+
+/*! \brief
+ * Scenario id given to rows that arrive through the sink interface.
+ */
+void ColumnarHistoryWriter::SetScenario(unsigned Scenario)
+{
+  Scenario_ = Scenario;
+}
+
+void ColumnarHistoryWriter::Row(const HistoryRow& Row)
+{
+  Append(Scenario_, Row.Year, Row.Total, Row.Interest, Row.Contribution);
+}
+
+/*! \brief
+ * Writes the last batch, the batch index and the tail, and closes the
+ * file. Further appends throw.
+ */
+void ColumnarHistoryWriter::Close()
+{
+  if (!File_.is_open())
+  {
+    return;
+  }
+  WriteBatch();
+  uint64_t IndexOffset = Offset_;
+  WriteBytes(Batches_.data(), Batches_.size() * sizeof(BatchEntry));
+  FileTail Tail = {};
+  Tail.IndexOffset = IndexOffset;
+  Tail.Batches = Batches_.size();
+  std::memcpy(Tail.Magic, ColumnarMagic, sizeof(ColumnarMagic));
+  WriteBytes(&Tail, sizeof(Tail));
+  File_.close();
+  if (!File_)
+  {
+    throw std::runtime_error("Could not write columnar file " + Path_);
+  }
+}
+
+/*! \brief
+ * Maps a columnar file read-only and checks its header, index and every
+ * batch against the file size.
+ */
+ColumnarHistoryReader::ColumnarHistoryReader(const std::string& Path)
+{
+  File_ = open(Path.c_str(), O_RDONLY);
+  if (File_ < 0)
+  {
+    throw std::system_error(errno, std::generic_category(), "Could not open columnar file " + Path);
+  }
+  struct stat Status;
+  if (fstat(File_, &Status) != 0)
+  {
+    int Error = errno;
+    Release();
+    throw std::system_error(Error, std::generic_category(), "Could not read columnar file " + Path);
+  }
+  MapBytes_ = static_cast<size_t>(Status.st_size);
+  if (MapBytes_ < sizeof(FileHeader) + sizeof(FileTail))
+  {
+    Release();
+    throw std::invalid_argument(Path + " is not a columnar history file.");
+  }
+  void* Map = mmap(nullptr, MapBytes_, PROT_READ, MAP_SHARED, File_, 0);
+  if (Map == MAP_FAILED)
+  {
+    int Error = errno;
+    Release();
+    throw std::system_error(Error, std::generic_category(), "Could not map columnar file " + Path);
+  }
+  Map_ = static_cast<const char*>(Map);
+
+  const FileHeader* Header = reinterpret_cast<const FileHeader*>(Map_);
+  const FileTail* Tail = reinterpret_cast<const FileTail*>(Map_ + MapBytes_ - sizeof(FileTail));
+  uint64_t IndexBytes = MapBytes_ - sizeof(FileTail) - Tail->IndexOffset;
+  bool Valid = std::memcmp(Header->Magic, ColumnarMagic, sizeof(ColumnarMagic)) == 0 &&
+               std::memcmp(Tail->Magic, ColumnarMagic, sizeof(ColumnarMagic)) == 0 &&
+               Header->Version == ColumnarVersion && Header->Columns == ColumnCount &&
+               std::memcmp(Header->Schema, Schema, sizeof(Schema)) == 0 &&
+               Tail->IndexOffset >= sizeof(FileHeader) && Tail->IndexOffset <= MapBytes_ - sizeof(FileTail) &&
+               IndexBytes == Tail->Batches * sizeof(uint64_t) * 2;
+  for (uint64_t i = 0; Valid && i < Tail->Batches; ++i)
+  {
+    uint64_t Entry[2];
+    std::memcpy(Entry, Map_ + Tail->IndexOffset + i * sizeof(Entry), sizeof(Entry));
+    if (Entry[0] % SectionAlignment != 0 || Entry[0] + sizeof(BatchHeader) > Tail->IndexOffset)
+    {
+      Valid = false;
+      break;
+    }
+    const BatchHeader* BatchStart = reinterpret_cast<const BatchHeader*>(Map_ + Entry[0]);
+    Batch Columns;
+    Columns.Rows = BatchStart->Rows;
+    Valid = (Columns.Rows == Entry[1]);
+    for (int Column = 0; Valid && Column < ColumnCount; ++Column)
+    {
+      uint64_t Start = BatchStart->ColumnOffsets[Column];
+      Valid = Start % SectionAlignment == 0 && Columns.Rows <= (Tail->IndexOffset - Entry[0]) / Schema[Column].Width &&
+              Start <= Tail->IndexOffset - Entry[0] - Columns.Rows * Schema[Column].Width;
+      Columns.Columns[Column] = Map_ + Entry[0] + Start;
+    }
+    Batches_.push_back(Columns);
+    Rows_ += Columns.Rows;
+  }
+  if (!Valid)
+  {
+    Release();
+    throw std::invalid_argument(Path + " is not a columnar history file this version can read.");
+  }
+}
+
+ColumnarHistoryReader::~ColumnarHistoryReader()
+{
+  Release();
+}
+
+//Unmaps and closes whatever the constructor got to.
+void ColumnarHistoryReader::Release()
+{
+  if (Map_ != nullptr)
+  {
+    munmap(const_cast<char*>(Map_), MapBytes_);
+    Map_ = nullptr;
+  }
+  if (File_ >= 0)
+  {
+    close(File_);
+    File_ = -1;
+  }
+}
+
+size_t ColumnarHistoryReader::BatchCount()
+{
+  return Batches_.size();
+}
+
+size_t ColumnarHistoryReader::BatchRows(size_t Batch)
+{
+  return Batches_.at(Batch).Rows;
+}
+
+//Rows over every batch.
+uint64_t ColumnarHistoryReader::Rows()
+{
+  return Rows_;
+}
+
+const uint32_t* ColumnarHistoryReader::Scenarios(size_t Batch)
+{
+  return reinterpret_cast<const uint32_t*>(Batches_.at(Batch).Columns[0]);
+}
+
+const int32_t* ColumnarHistoryReader::Years(size_t Batch)
+{
+  return reinterpret_cast<const int32_t*>(Batches_.at(Batch).Columns[1]);
+}
+
+const double* ColumnarHistoryReader::Totals(size_t Batch)
+{
+  return reinterpret_cast<const double*>(Batches_.at(Batch).Columns[2]);
+}
+
+const double* ColumnarHistoryReader::Interest(size_t Batch)
+{
+  return reinterpret_cast<const double*>(Batches_.at(Batch).Columns[3]);
+}
+
+const double* ColumnarHistoryReader::Contributions(size_t Batch)
+{
+  return reinterpret_cast<const double*>(Batches_.at(Batch).Columns[4]);
+}
@@ -0,0 +1,103 @@
+/**********************************************************************/
+/*! \file  ColumnarHistory.h
+ * \author Seth Peterson
+ * \date   2020-10-19
+ * \brief
+ *     Columnar binary files of projection rows, laid out like Arrow
+ *     record batches: each column of a batch is one contiguous, 64 byte
+ *     aligned, little endian buffer. A reader maps the file and hands the
+ *     buffers out in place, with no parsing.
+ */
+/**********************************************************************/
+#ifndef COLUMNARHISTORY_H
+#define COLUMNARHISTORY_H
+
+#include "HistorySink.h" //The writer takes rows as a sink
+#include <cstddef> //For size_t
+#include <cstdint> //Fixed width column types
+#include <fstream> //Output file
+#include <string> //File paths
+#include <vector> //Pending batch and batch index
+
+class InvestmentData;
+
+/* Writes the columns scenario_id (uint32), year (int32), total, interest
+ * and contribution (float64). Rows are collected into batches of
+ * BatchRows rows; Close writes the last batch and the batch index. */
+class ColumnarHistoryWriter : public HistorySink
+{
+  private:
+    std::string Path_;
+    std::ofstream File_;
+    uint64_t Offset_ = 0;
+    size_t BatchRows_;
+    unsigned Scenario_ = 0;
+
+    std::vector<uint32_t> Scenarios_;
+    std::vector<int32_t> Years_;
+    std::vector<double> Totals_;
+    std::vector<double> Interest_;
+    std::vector<double> Contributions_;
+
+    struct BatchEntry
+    {
+      uint64_t Offset;
+      uint64_t Rows;
+    };
+    std::vector<BatchEntry> Batches_;
+
+    void WriteBytes(const void* Bytes, size_t Size);
+    void WritePadding();
+    void WriteBatch();
+
+  public:
+    ColumnarHistoryWriter(const std::string& Path, size_t BatchRows = 1 << 16);
+    ~ColumnarHistoryWriter();
+
+    ColumnarHistoryWriter(const ColumnarHistoryWriter&) = delete;
+    ColumnarHistoryWriter& operator=(const ColumnarHistoryWriter&) = delete;
+
+    void Append(uint32_t Scenario, int32_t Year, double Total, double Interest, double Contribution);
+    void Append(uint32_t Scenario, InvestmentData& History);
+    void SetScenario(unsigned Scenario);
+    void Row(const HistoryRow& Row) override;
+    void Close();
+};
+
+/* Read-only mapping of a ColumnarHistoryWriter file. Column pointers are
+ * valid for the reader's lifetime. */
+class ColumnarHistoryReader
+{
+  private:
+    int File_ = -1;
+    const char* Map_ = nullptr;
+    size_t MapBytes_ = 0;
+
+    struct Batch
+    {
+      uint64_t Rows;
+      const char* Columns[5];
+    };
+    std::vector<Batch> Batches_;
+    uint64_t Rows_ = 0;
+
+    void Release();
+
+  public:
+    ColumnarHistoryReader(const std::string& Path);
+    ~ColumnarHistoryReader();
+
+    ColumnarHistoryReader(const ColumnarHistoryReader&) = delete;
+    ColumnarHistoryReader& operator=(const ColumnarHistoryReader&) = delete;
+
+    size_t BatchCount();
+    size_t BatchRows(size_t Batch);
+    uint64_t Rows();
+    const uint32_t* Scenarios(size_t Batch);
+    const int32_t* Years(size_t Batch);
+    const double* Totals(size_t Batch);
+    const double* Interest(size_t Batch);
+    const double* Contributions(size_t Batch);
+};
+
+#endif
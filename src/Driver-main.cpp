@@ -8,19 +8,41 @@
  */
 /**********************************************************************/
 #include "InvestmentCalculator.h"
+#include "HistorySink.h" //For the csv and json output modes
+#include "ParameterSweep.h" //For the sweep mode
+#include "ThreadPool.h" //Workers for the sweep mode
+#include "AsyncWriter.h" //Writes output while the next rows are formatted
+#include "OutputBuffer.h" //For StandardOutput
 #include <string> //For stod
 #include <cstdio> //For printf
 #include <stdexcept> //For exception handling when given bad input
 #include "../json/json.h" //Needed to parse Data.json
 #include "../json/value.h" //Needed to parse Data.json
 #include <fstream>  //Needed to read Data.json
+#include <vector> //Output matrix for the sweep mode, remaining arguments
+
+/* Projects with rows streamed to stdout as a table. The writer is attached
+ * first, so rows are written while later years are still being projected.
+ * The cumulative row follows through the same writer, in order. */
+void PrintProjection(InvestmentCalculator& ic, int Years, bool cumulative)
+{
+  AsyncWriter writer;
+  TableSink table;
+  table.SetAsyncWriter(&writer);
+  ic.PredictGrowth(Years, table);
+  table.SetAsyncWriter(nullptr);
+  if (cumulative)
+  {
+    StandardOutput().SetAsyncWriter(&writer);
+    ic.PrintCumulativeHistory();
+    StandardOutput().SetAsyncWriter(nullptr);
+  }
+}
 
 void TestCalculator(double Capital, double Interest, double Contribution, double Years)
 {
   InvestmentCalculator ic = InvestmentCalculator(Capital, Interest, Contribution);
-  ic.PredictGrowth(Years);
-  ic.PrintHistory();
-  ic.PrintCumulativeHistory();
+  PrintProjection(ic, Years, true);
 }
 
 void TestData()
@@ -44,8 +66,51 @@ void TestHistory()
   int Years = 38;
 
   InvestmentCalculator ic = InvestmentCalculator(InitialMoney, Interest, Contribution);
-  ic.PredictGrowth(Years);
-  ic.PrintHistory();
+  PrintProjection(ic, Years, false);
+}
+
+/* Reads one {"Start", "Step", "Count"} object of a sweep file. */
+SweepRange ReadSweepRange(const Json::Value& range)
+{
+  SweepRange result;
+  result.Start = range["Start"].asDouble();
+  result.Step = range["Step"].asDouble();
+  result.Count = range.isMember("Count") ? range["Count"].asUInt() : 1;
+  return result;
+}
+
+/* Evaluates every combination of the ranges in a sweep file in-process. */
+int RunSweepFile(const std::string& file_name, bool csv, bool json)
+{
+  Json::Value inputs;
+  std::ifstream input_file(file_name, std::ifstream::binary);
+  input_file >> inputs;
+
+  SweepGrid grid;
+  grid.Capital = ReadSweepRange(inputs["Capital"]);
+  grid.Rate = ReadSweepRange(inputs["Interest"]);
+  grid.Contribution = ReadSweepRange(inputs["Contribution"]);
+  grid.Years = ReadSweepRange(inputs["Years"]);
+
+  std::vector<double> totals(grid.Cells());
+  ThreadPool pool;
+  RunSweep(grid, totals.data(), pool);
+  AsyncWriter writer;
+  StandardOutput().SetAsyncWriter(&writer);
+  if (csv)
+  {
+    PrintSweepCsv(grid, totals.data());
+  }
+  else if (json)
+  {
+    PrintSweepJson(grid, totals.data());
+  }
+  else
+  {
+    PrintSweep(grid, totals.data());
+  }
+  StandardOutput().SetAsyncWriter(nullptr);
+  return 0;
 }
 
 int main(int argc, char* argv[])
@@ -61,6 +126,29 @@ int main(int argc, char* argv[])
   */
   /**************BELOW IS DEFAULT FUNCTIONALITY************/
 
+  //"--csv" or "--json" anywhere on the command line switches the output
+  //to CSV or JSON.
+  bool csv = false;
+  bool json = false;
+  std::vector<char*> args;
+  for (int i = 0; i < argc; ++i)
+  {
+    if (std::string(argv[i]) == "--csv")
+    {
+      csv = true;
+    }
+    else if (std::string(argv[i]) == "--json")
+    {
+      json = true;
+    }
+    else
+    {
+      args.push_back(argv[i]);
+    }
+  }
+  argc = static_cast<int>(args.size());
+  argv = args.data();
+
   double InitialMoney = 0.00;
   double Interest = 0.00;
   double Contribution = 0.00;
@@ -113,6 +201,11 @@ int main(int argc, char* argv[])
       }
     }
   }
+  //Client asked for a parameter sweep described by a json file.
+  else if (argc == 3 && std::string(argv[1]) == "sweep")
+  {
+    return RunSweepFile(argv[2], csv, json);
+  }
   //User gave only program name as an argument.
   // Check for Input.json
   else if (argc == 1)
@@ -135,8 +228,26 @@ int main(int argc, char* argv[])
   }
 
   InvestmentCalculator ic = InvestmentCalculator(InitialMoney, Interest, Contribution);
-  ic.PredictGrowth(Years);
-  ic.PrintHistory();
-  ic.PrintCumulativeHistory();
+  if (csv)
+  {
+    //Rows go out as they are computed, written on the writer's thread.
+    AsyncWriter writer;
+    CsvSink out;
+    out.SetAsyncWriter(&writer);
+    ic.PredictGrowth(Years, out);
+    out.SetAsyncWriter(nullptr);
+    return 0;
+  }
+  if (json)
+  {
+    AsyncWriter writer;
+    JsonSink out;
+    out.SetAsyncWriter(&writer);
+    ic.PredictGrowth(Years, out);
+    out.Close();
+    out.SetAsyncWriter(nullptr);
+    return 0;
+  }
+  PrintProjection(ic, Years, true);
 }
 
@@ -0,0 +1,103 @@
+/**********************************************************************/
+/*! \file  HistoryArena.cpp
+ * \author Seth Peterson
+ * \date   2020-10-02
+ * \brief
+ *     Bump allocator for history buffers. Allocations are never freed one
+ *     by one; Reset rewinds the whole arena, keeping its blocks for the
+ *     next batch. Anything allocated from the arena must not be used after
+ *     Reset or after the arena is destroyed.
+ */
+/**********************************************************************/
+#include "HistoryArena.h"
+#include <new> //For aligned operator new
+
+//Blocks are aligned to a cache line, so any smaller alignment is free.
+static const size_t BlockAlignment = 64;
+
+/*! \brief
+ * Constructs an empty arena; no memory is taken until the first Allocate.
+ * \param BlockSize
+ * Bytes per block. Requests larger than this get a block of their own.
+ */
+HistoryArena::HistoryArena(size_t BlockSize) :
+  BlockSize_(BlockSize)
+{
+}
+
+//Destructor returns every block to the heap.
+HistoryArena::~HistoryArena()
+{
+  Reset();
+  for (char* Block : Blocks_)
+  {
+    ::operator delete(Block, std::align_val_t(BlockAlignment));
+  }
+}
+
+/*! \brief
+ * Hands out memory from the current block, moving on when it is full.
+ * \param Bytes
+ * Size of the request.
+ * \param Alignment
+ * Power of two, at most 64.
+ * \return
+ * Pointer valid until the next Reset.
+ */
+void* HistoryArena::Allocate(size_t Bytes, size_t Alignment)
+{
+  BytesUsed_ += Bytes;
+  if (Bytes > BlockSize_)
+  {
+    char* Block = static_cast<char*>(::operator new(Bytes, std::align_val_t(BlockAlignment)));
+    LargeBlocks_.push_back(Block);
+    return Block;
+  }
+
+  size_t Start = (Offset_ + Alignment - 1) & ~(Alignment - 1);
+  if (Blocks_.empty() || Start + Bytes > BlockSize_)
+  {
+    NextBlock();
+    Start = 0;
+  }
+  Offset_ = Start + Bytes;
+  return Blocks_[CurrentBlock_] + Start;
+}
+
+//Moves to the next kept block, allocating one if every block is in use.
+void HistoryArena::NextBlock()
+{
+  if (!Blocks_.empty())
+  {
+    ++CurrentBlock_;
+  }
+  if (CurrentBlock_ == Blocks_.size())
+  {
+    Blocks_.push_back(static_cast<char*>(::operator new(BlockSize_, std::align_val_t(BlockAlignment))));
+  }
+  Offset_ = 0;
+}
+
+/*! \brief
+ * Releases every allocation at once. Regular blocks are kept for reuse,
+ * requests that needed a block of their own go back to the heap.
+ */
+void HistoryArena::Reset()
+{
+  for (char* Block : LargeBlocks_)
+  {
+    ::operator delete(Block, std::align_val_t(BlockAlignment));
+  }
+  LargeBlocks_.clear();
+  CurrentBlock_ = 0;
+  Offset_ = 0;
+  BytesUsed_ = 0;
+}
+
+/*! \brief
+ * Bytes handed out since the last Reset.
+ */
+size_t HistoryArena::BytesUsed()
+{
+  return BytesUsed_;
+}
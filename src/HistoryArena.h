@@ -0,0 +1,41 @@
+/**********************************************************************/
+/*! \file  HistoryArena.h
+ * \author Seth Peterson
+ * \date   2020-10-02
+ * \brief
+ *     Bump allocator that batch runs hand to calculators so every history
+ *     buffer of a batch comes from a few large blocks and is released by a
+ *     single Reset.
+ */
+/**********************************************************************/
+#ifndef HISTORYARENA_H
+#define HISTORYARENA_H
+
+#include <cstddef> //For size_t
+#include <vector> //Owned blocks
+
+class HistoryArena
+{
+  private:
+    std::vector<char*> Blocks_;
+    std::vector<char*> LargeBlocks_;
+    size_t BlockSize_;
+    size_t CurrentBlock_ = 0;
+    size_t Offset_ = 0;
+    size_t BytesUsed_ = 0;
+
+    void NextBlock();
+
+  public:
+    HistoryArena(size_t BlockSize = 1 << 20);
+    ~HistoryArena();
+
+    HistoryArena(const HistoryArena&) = delete;
+    HistoryArena& operator=(const HistoryArena&) = delete;
+
+    void* Allocate(size_t Bytes, size_t Alignment = 64);
+    void Reset();
+    size_t BytesUsed();
+};
+
+#endif
@@ -0,0 +1,473 @@
+/**********************************************************************/
+/*! \file  HistoryCodec.cpp
+ * \author Seth Peterson
+ * \date   2020-10-07
+ * \brief
+ *     Gorilla style XOR encoding of history columns, and pack files of
+ *     many encoded histories.
+ *
+ *     An encoded history is four little endian 32 bit fields (rows,
+ *     start year, year step, last row's year) followed by the total,
+ *     interest and contribution columns, each as a 32 bit byte count and
+ *     a bit stream. The last row's year differs from the steps when that
+ *     row covers fewer years than the rest.
+ *     In a stream the first value is stored whole. Every later value is
+ *     XORed with the one before it and stored as
+ *       0                     - same value as the previous row
+ *       10 + bits             - XOR fits the previous leading/trailing
+ *                               zero window, only its middle bits follow
+ *       11 + 5 + 6 + bits     - new window: leading zeros, significant
+ *                               bit count minus one, significant bits
+ *     Constant columns (contributions) cost one bit a row; totals that
+ *     grow smoothly share sign, exponent and top mantissa bits.
+ *
+ *     A pack is a 16 byte header, the encoded histories back to back, an
+ *     index of (scenario, offset, bytes) entries and a 16 byte footer with
+ *     the index offset and entry count.
+ */
+/**********************************************************************/
+#include "HistoryCodec.h"
+#include <algorithm> //For std::min, std::sort and std::lower_bound
+#include <cstring> //For memcpy
+#include <stdexcept> //For malformed input and file errors
+
+static const char PackMagic[8] = {'I', 'C', 'P', 'A', 'C', 'K', '\0', '\0'};
+static const uint32_t PackVersion = 2;
+static const size_t PackHeaderBytes = 16;
+static const size_t PackFooterBytes = 16;
+static const size_t PackEntryBytes = 16;
+static const size_t HistoryHeaderBytes = 16;
+
+static void PutU32(std::vector<unsigned char>& Out, uint32_t Value)
+{
+  for (int Byte = 0; Byte < 4; ++Byte)
+  {
+    Out.push_back(static_cast<unsigned char>(Value >> (8 * Byte)));
+  }
+}
+
+static void PutU64(std::vector<unsigned char>& Out, uint64_t Value)
+{
+  PutU32(Out, static_cast<uint32_t>(Value));
+  PutU32(Out, static_cast<uint32_t>(Value >> 32));
+}
+
+static uint32_t GetU32(const unsigned char* Bytes)
+{
+  return static_cast<uint32_t>(Bytes[0]) | (static_cast<uint32_t>(Bytes[1]) << 8) |
+         (static_cast<uint32_t>(Bytes[2]) << 16) | (static_cast<uint32_t>(Bytes[3]) << 24);
+}
+
+static uint64_t GetU64(const unsigned char* Bytes)
+{
+  return static_cast<uint64_t>(GetU32(Bytes)) | (static_cast<uint64_t>(GetU32(Bytes + 4)) << 32);
+}
+
+static uint64_t DoubleBits(double Value)
+{
+  uint64_t Bits;
+  std::memcpy(&Bits, &Value, sizeof(Bits));
+  return Bits;
+}
+
+static double BitsDouble(uint64_t Bits)
+{
+  double Value;
+  std::memcpy(&Value, &Bits, sizeof(Value));
+  return Value;
+}
+
+//Appends bit fields to a byte vector, most significant bit first.
+class BitWriter
+{
+  private:
+    std::vector<unsigned char>& Out_;
+    uint64_t Buffer_ = 0;
+    int Bits_ = 0;
+
+  public:
+    BitWriter(std::vector<unsigned char>& Out) : Out_(Out) {}
+
+    //Writes the low Count bits of Value, 1 <= Count <= 64.
+    void Write(uint64_t Value, int Count)
+    {
+      if (Count > 32)
+      {
+        Write(Value >> 32, Count - 32);
+        Count = 32;
+      }
+      Buffer_ = (Buffer_ << Count) | (Value & ((uint64_t(1) << Count) - 1));
+      Bits_ += Count;
+      while (Bits_ >= 8)
+      {
+        Bits_ -= 8;
+        Out_.push_back(static_cast<unsigned char>(Buffer_ >> Bits_));
+      }
+    }
+
+    //Pads the last partial byte with zeros.
+    void Finish()
+    {
+      if (Bits_ > 0)
+      {
+        Out_.push_back(static_cast<unsigned char>(Buffer_ << (8 - Bits_)));
+        Bits_ = 0;
+      }
+    }
+};
+
+//Reads what BitWriter wrote, throwing rather than reading past the end.
+class BitReader
+{
+  private:
+    const unsigned char* Data_;
+    size_t Bits_;
+    size_t Position_ = 0;
+
+  public:
+    BitReader(const unsigned char* Data, size_t Bytes) : Data_(Data), Bits_(Bytes * 8) {}
+
+    uint64_t Read(int Count)
+    {
+      if (Position_ + Count > Bits_)
+      {
+        throw std::invalid_argument("Encoded history column ends early.");
+      }
+      uint64_t Value = 0;
+      while (Count > 0)
+      {
+        int Offset = static_cast<int>(Position_ & 7);
+        int Take = std::min(8 - Offset, Count);
+        unsigned Byte = Data_[Position_ >> 3];
+        Value = (Value << Take) | ((Byte >> (8 - Offset - Take)) & ((1u << Take) - 1));
+        Position_ += Take;
+        Count -= Take;
+      }
+      return Value;
+    }
+};
+
+//Appends one column, read with At, as a byte count and its bit stream.
+static void EncodeColumn(InvestmentData& History, double (InvestmentData::*At)(int), std::vector<unsigned char>& Out)
+{
+  int Rows = History.Size();
+  size_t CountAt = Out.size();
+  PutU32(Out, 0);
+  BitWriter Writer(Out);
+  uint64_t Previous = 0;
+  int PreviousLeading = -1;
+  int PreviousTrailing = 0;
+  for (int Row = 0; Row < Rows; ++Row)
+  {
+    uint64_t Bits = DoubleBits((History.*At)(Row));
+    uint64_t Xor = Bits ^ Previous;
+    Previous = Bits;
+    if (Row == 0)
+    {
+      Writer.Write(Bits, 64);
+    }
+    else if (Xor == 0)
+    {
+      Writer.Write(0, 1);
+    }
+    else
+    {
+      //Five bits hold at most 31 leading zeros.
+      int Leading = std::min(__builtin_clzll(Xor), 31);
+      int Trailing = __builtin_ctzll(Xor);
+      if (PreviousLeading >= 0 && Leading >= PreviousLeading && Trailing >= PreviousTrailing)
+      {
+        Writer.Write(2, 2);
+        Writer.Write(Xor >> PreviousTrailing, 64 - PreviousLeading - PreviousTrailing);
+      }
+      else
+      {
+        int Significant = 64 - Leading - Trailing;
+        Writer.Write(3, 2);
+        Writer.Write(Leading, 5);
+        Writer.Write(Significant - 1, 6);
+        Writer.Write(Xor >> Trailing, Significant);
+        PreviousLeading = Leading;
+        PreviousTrailing = Trailing;
+      }
+    }
+  }
+  Writer.Finish();
+  uint32_t Bytes = static_cast<uint32_t>(Out.size() - CountAt - 4);
+  for (int Byte = 0; Byte < 4; ++Byte)
+  {
+    Out[CountAt + Byte] = static_cast<unsigned char>(Bytes >> (8 * Byte));
+  }
+}
+
+//Decodes one column written by EncodeColumn, returning the bytes it used.
+static size_t DecodeColumn(const unsigned char* Bytes, size_t Size, int Rows, double* Values)
+{
+  if (Size < 4 || GetU32(Bytes) > Size - 4)
+  {
+    throw std::invalid_argument("Encoded history column ends early.");
+  }
+  size_t ColumnBytes = GetU32(Bytes);
+  BitReader Reader(Bytes + 4, ColumnBytes);
+  uint64_t Previous = 0;
+  int Leading = 0;
+  int Trailing = 0;
+  for (int Row = 0; Row < Rows; ++Row)
+  {
+    if (Row == 0)
+    {
+      Previous = Reader.Read(64);
+    }
+    else if (Reader.Read(1) == 1)
+    {
+      if (Reader.Read(1) == 1)
+      {
+        Leading = static_cast<int>(Reader.Read(5));
+        Trailing = 64 - Leading - static_cast<int>(Reader.Read(6)) - 1;
+        if (Trailing < 0)
+        {
+          throw std::invalid_argument("Encoded history column is corrupt.");
+        }
+      }
+      Previous ^= Reader.Read(64 - Leading - Trailing) << Trailing;
+    }
+    Values[Row] = BitsDouble(Previous);
+  }
+  return 4 + ColumnBytes;
+}
+
+/*! \brief
+ * Encodes every row of a history, bit for bit.
+ * \return
+ * Bytes for DecodeHistory or a pack.
+ */
+std::vector<unsigned char> EncodeHistory(InvestmentData& History)
+{
+  int Rows = History.Size();
+  std::vector<unsigned char> Out;
+  //Smooth columns usually take well under half their raw size.
+  Out.reserve(HistoryHeaderBytes + 12 + Rows * 3 * sizeof(double) / 2);
+  PutU32(Out, static_cast<uint32_t>(Rows));
+  PutU32(Out, static_cast<uint32_t>(History.StartYear()));
+  PutU32(Out, static_cast<uint32_t>(History.YearStep()));
+  PutU32(Out, static_cast<uint32_t>((Rows > 0) ? History.YearAt(Rows - 1) : History.StartYear()));
+  EncodeColumn(History, &InvestmentData::TotalAt, Out);
+  EncodeColumn(History, &InvestmentData::InterestAt, Out);
+  EncodeColumn(History, &InvestmentData::ContributionAt, Out);
+  return Out;
+}
+
+/*! \brief
+ * Rebuilds a history from EncodeHistory's bytes.
+ * \param Bytes
+ * Start of the encoded history.
+ * \param Size
+ * Bytes available; decoding throws rather than read past them.
+ */
+InvestmentData DecodeHistory(const unsigned char* Bytes, size_t Size)
+{
+  if (Size < HistoryHeaderBytes)
+  {
+    throw std::invalid_argument("Encoded history is too short.");
+  }
+  int Rows = static_cast<int>(GetU32(Bytes));
+  int StartYear = static_cast<int>(GetU32(Bytes + 4));
+  int YearStep = static_cast<int>(GetU32(Bytes + 8));
+  int LastYear = static_cast<int>(GetU32(Bytes + 12));
+  if (Rows < 0 || YearStep <= 0)
+  {
+    throw std::invalid_argument("Encoded history is corrupt.");
+  }
+  //Each column holds at least a whole first value and one bit for every
+  //later row, so a corrupt row count is caught before it is allocated.
+  size_t ColumnBits = (Rows > 0) ? 64 + static_cast<size_t>(Rows) - 1 : 0;
+  if (3 * (4 + (ColumnBits + 7) / 8) > Size - HistoryHeaderBytes)
+  {
+    throw std::invalid_argument("Encoded history ends early.");
+  }
+  std::vector<double> Columns(3 * static_cast<size_t>(Rows));
+  size_t Position = HistoryHeaderBytes;
+  for (int Column = 0; Column < 3; ++Column)
+  {
+    Position += DecodeColumn(Bytes + Position, Size - Position, Rows, Columns.data() + Column * Rows);
+  }
+
+  InvestmentData History(StartYear, YearStep);
+  History.Reserve(Rows);
+  for (int Row = 0; Row < Rows; ++Row)
+  {
+    History.Append(Columns[Row], Columns[Rows + Row], Columns[2 * Rows + Row]);
+  }
+  if (Rows > 0 && LastYear != History.YearAt(Rows - 1))
+  {
+    History.LabelLastRow(LastYear);
+  }
+  return History;
+}
+
+/*! \brief
+ * Creates (or truncates) a pack file.
+ */
+HistoryPackWriter::HistoryPackWriter(const std::string& Path) :
+  Path_(Path), File_(Path, std::ios::binary | std::ios::trunc)
+{
+  if (!File_)
+  {
+    throw std::runtime_error("Could not create history pack " + Path);
+  }
+  std::vector<unsigned char> Header(PackMagic, PackMagic + sizeof(PackMagic));
+  PutU32(Header, PackVersion);
+  PutU32(Header, 0);
+  File_.write(reinterpret_cast<const char*>(Header.data()), Header.size());
+  Offset_ = Header.size();
+}
+
+//Destructor writes the index if Close was not called. Errors are lost
+//here; call Close first to see them.
+HistoryPackWriter::~HistoryPackWriter()
+{
+  try
+  {
+    Close();
+  }
+  catch (...)
+  {
+  }
+}
+
+/*! \brief
+ * Encodes a history and appends it to the pack.
+ * \param Scenario
+ * Key for HistoryPackReader::Read; each scenario may be added once.
+ */
+void HistoryPackWriter::Add(uint32_t Scenario, InvestmentData& History)
+{
+  if (!File_.is_open())
+  {
+    throw std::logic_error("History pack " + Path_ + " is already closed.");
+  }
+  if (!Scenarios_.insert(Scenario).second)
+  {
+    throw std::invalid_argument("Scenario " + std::to_string(Scenario) + " is already in the pack.");
+  }
+  std::vector<unsigned char> Encoded = EncodeHistory(History);
+  File_.write(reinterpret_cast<const char*>(Encoded.data()), Encoded.size());
+  Index_.push_back(HistoryPackEntry{Scenario, Offset_, static_cast<uint32_t>(Encoded.size())});
+  Offset_ += Encoded.size();
+}
+
+/*! \brief
+ * Writes the index and footer and closes the file. Further adds throw.
+ */
+void HistoryPackWriter::Close()
+{
+  if (!File_.is_open())
+  {
+    return;
+  }
+  std::vector<unsigned char> Tail;
+  Tail.reserve(Index_.size() * PackEntryBytes + PackFooterBytes);
+  for (const HistoryPackEntry& Entry : Index_)
+  {
+    PutU32(Tail, Entry.Scenario);
+    PutU64(Tail, Entry.Offset);
+    PutU32(Tail, Entry.Bytes);
+  }
+  PutU64(Tail, Offset_);
+  PutU64(Tail, Index_.size());
+  File_.write(reinterpret_cast<const char*>(Tail.data()), Tail.size());
+  File_.close();
+  if (!File_)
+  {
+    throw std::runtime_error("Could not write history pack " + Path_);
+  }
+}
+
+/*! \brief
+ * Opens a pack and loads its index; no history is decoded yet.
+ */
+HistoryPackReader::HistoryPackReader(const std::string& Path) :
+  Path_(Path), File_(Path, std::ios::binary)
+{
+  if (!File_)
+  {
+    throw std::runtime_error("Could not open history pack " + Path);
+  }
+  File_.seekg(0, std::ios::end);
+  uint64_t Size = static_cast<uint64_t>(File_.tellg());
+  unsigned char Header[PackHeaderBytes];
+  unsigned char Footer[PackFooterBytes];
+  if (Size < PackHeaderBytes + PackFooterBytes)
+  {
+    throw std::invalid_argument(Path + " is not a history pack.");
+  }
+  File_.seekg(0);
+  File_.read(reinterpret_cast<char*>(Header), PackHeaderBytes);
+  File_.seekg(Size - PackFooterBytes);
+  File_.read(reinterpret_cast<char*>(Footer), PackFooterBytes);
+  uint64_t IndexOffset = GetU64(Footer);
+  uint64_t Entries = GetU64(Footer + 8);
+  if (!File_ || std::memcmp(Header, PackMagic, sizeof(PackMagic)) != 0 || GetU32(Header + 8) != PackVersion ||
+      IndexOffset < PackHeaderBytes || IndexOffset > Size - PackFooterBytes ||
+      (Size - PackFooterBytes - IndexOffset) / PackEntryBytes != Entries ||
+      (Size - PackFooterBytes - IndexOffset) % PackEntryBytes != 0)
+  {
+    throw std::invalid_argument(Path + " is not a history pack this version can read.");
+  }
+
+  std::vector<unsigned char> Raw(Entries * PackEntryBytes);
+  File_.seekg(IndexOffset);
+  File_.read(reinterpret_cast<char*>(Raw.data()), Raw.size());
+  Index_.reserve(Entries);
+  for (uint64_t Entry = 0; Entry < Entries; ++Entry)
+  {
+    const unsigned char* Field = Raw.data() + Entry * PackEntryBytes;
+    Index_.push_back(HistoryPackEntry{GetU32(Field), GetU64(Field + 4), GetU32(Field + 12)});
+  }
+  //Sorted by scenario so Read can binary search.
+  std::sort(Index_.begin(), Index_.end(), [](const HistoryPackEntry& A, const HistoryPackEntry& B)
+  {
+    return A.Scenario < B.Scenario;
+  });
+}
+
+//Scenarios in the pack.
+size_t HistoryPackReader::Count()
+{
+  return Index_.size();
+}
+
+//Scenario identifiers in increasing order, for walking the whole pack.
+uint32_t HistoryPackReader::ScenarioAt(size_t Index)
+{
+  return Index_.at(Index).Scenario;
+}
+
+bool HistoryPackReader::Contains(uint32_t Scenario)
+{
+  auto Entry = std::lower_bound(Index_.begin(), Index_.end(), Scenario,
+      [](const HistoryPackEntry& A, uint32_t Key) { return A.Scenario < Key; });
+  return Entry != Index_.end() && Entry->Scenario == Scenario;
+}
+
+/*! \brief
+ * Reads and decodes one scenario's history, leaving the rest untouched.
+ */
+InvestmentData HistoryPackReader::Read(uint32_t Scenario)
+{
+  auto Entry = std::lower_bound(Index_.begin(), Index_.end(), Scenario,
+      [](const HistoryPackEntry& A, uint32_t Key) { return A.Scenario < Key; });
+  if (Entry == Index_.end() || Entry->Scenario != Scenario)
+  {
+    throw std::out_of_range("Scenario " + std::to_string(Scenario) + " is not in " + Path_);
+  }
+  std::vector<unsigned char> Encoded(Entry->Bytes);
+  File_.clear();
+  File_.seekg(Entry->Offset);
+  File_.read(reinterpret_cast<char*>(Encoded.data()), Encoded.size());
+  if (!File_)
+  {
+    throw std::runtime_error("Could not read scenario " + std::to_string(Scenario) + " from " + Path_);
+  }
+  return DecodeHistory(Encoded.data(), Encoded.size());
+}
@@ -0,0 +1,73 @@
+/**********************************************************************/
+/*! \file  HistoryCodec.h
+ * \author Seth Peterson
+ * \date   2020-10-07
+ * \brief
+ *     Lossless compressed binary form of histories. Each column is XOR
+ *     encoded against the previous row (the Gorilla scheme), which
+ *     stores smooth or constant columns in a few bits per row. Packs hold
+ *     many histories plus an index, so one scenario can be decoded
+ *     without reading the others.
+ */
+/**********************************************************************/
+#ifndef HISTORYCODEC_H
+#define HISTORYCODEC_H
+
+#include "InvestmentData.h" //Histories to encode and decode
+#include <cstddef> //For size_t
+#include <cstdint> //Fixed width fields of the format
+#include <fstream> //Pack files
+#include <string> //File paths
+#include <unordered_set> //Scenarios already in a pack
+#include <vector> //Encoded bytes and the pack index
+
+std::vector<unsigned char> EncodeHistory(InvestmentData& History);
+InvestmentData DecodeHistory(const unsigned char* Bytes, size_t Size);
+
+/* Where one scenario's encoded history sits in a pack file. */
+struct HistoryPackEntry
+{
+  uint32_t Scenario;
+  uint64_t Offset;
+  uint32_t Bytes;
+};
+
+/* Writes encoded histories one after another, then the index on Close. */
+class HistoryPackWriter
+{
+  private:
+    std::string Path_;
+    std::ofstream File_;
+    uint64_t Offset_ = 0;
+    std::vector<HistoryPackEntry> Index_;
+    std::unordered_set<uint32_t> Scenarios_;
+
+  public:
+    HistoryPackWriter(const std::string& Path);
+    ~HistoryPackWriter();
+
+    HistoryPackWriter(const HistoryPackWriter&) = delete;
+    HistoryPackWriter& operator=(const HistoryPackWriter&) = delete;
+
+    void Add(uint32_t Scenario, InvestmentData& History);
+    void Close();
+};
+
+/* Reads only a pack's index when opened; Read decodes one scenario. */
+class HistoryPackReader
+{
+  private:
+    std::string Path_;
+    std::ifstream File_;
+    std::vector<HistoryPackEntry> Index_;
+
+  public:
+    HistoryPackReader(const std::string& Path);
+
+    size_t Count();
+    uint32_t ScenarioAt(size_t Index);
+    bool Contains(uint32_t Scenario);
+    InvestmentData Read(uint32_t Scenario);
+};
+
+#endif
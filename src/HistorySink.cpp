@@ -0,0 +1,363 @@
+/**********************************************************************/
+/*! \file  HistorySink.cpp
+ * \author Seth Peterson
+ * \date   2020-10-09
+ * \brief
+ *     Built in history sinks: table, CSV and JSON text, and a ring buffer
+ *     of the latest rows.
+ */
+/**********************************************************************/
+#include "HistorySink.h"
+#include "InvestmentData.h" //Shares PrintContents' row layout
+#include <stdexcept> //For bad paths, capacities and closed output
+
+//Big stdio buffers keep file sinks from making a system call per row.
+static const size_t FileBufferBytes = 1 << 16;
+
+//Opens a file for a sink, throwing when it cannot be created.
+static FILE* OpenSinkFile(const std::string& Path)
+{
+  FILE* Stream = fopen(Path.c_str(), "w");
+  if (Stream == nullptr)
+  {
+    throw std::runtime_error("Could not create history file " + Path);
+  }
+  setvbuf(Stream, nullptr, _IOFBF, FileBufferBytes);
+  return Stream;
+}
+
+/*! \brief
+ * Writes to a stream the caller keeps open.
+ */
+TableSink::TableSink(FILE* Stream) :
+  Stream_(Stream), Out_(Stream)
+{
+}
+
+void TableSink::Begin()
+{
+  Out_.Append("Year  :   Total  || Growth   |  Interest | Contribution\n");
+}
+
+void TableSink::Row(const HistoryRow& Row)
+{
+  AppendContentsRow(Out_, Row.Year, Row.Total, Row.Interest, Row.Contribution);
+}
+
+/*! \brief
+ * Hands full buffers to Writer's thread instead of writing them, so rows
+ * are written while the projection carries on. Null goes back to direct
+ * writes; detach before the writer is destroyed.
+ */
+void TableSink::SetAsyncWriter(AsyncWriter* Writer)
+{
+  Out_.SetAsyncWriter(Writer);
+}
+
+//Pushes the rows out so they are visible once the projection returns.
+void TableSink::End()
+{
+  Out_.Flush();
+}
+
+/*! \brief
+ * Creates (or truncates) the file at Path.
+ */
+FileSink::FileSink(const std::string& Path) :
+  TableSink(OpenSinkFile(Path))
+{
+}
+
+FileSink::~FileSink()
+{
+  //The buffer writes to the file's descriptor, so it goes out first.
+  try
+  {
+    Out_.Flush();
+  }
+  catch (...)
+  {
+  }
+  fclose(Stream_);
+}
+
+/*! \brief
+ * Writes to a stream the caller keeps open.
+ */
+CsvSink::CsvSink(FILE* Stream) :
+  Stream_(Stream), OwnsStream_(false), Out_(Stream)
+{
+}
+
+/*! \brief
+ * Creates (or truncates) the file at Path.
+ */
+CsvSink::CsvSink(const std::string& Path) :
+  Stream_(OpenSinkFile(Path)), OwnsStream_(true), Out_(Stream_)
+{
+}
+
+CsvSink::~CsvSink()
+{
+  try
+  {
+    Out_.Flush();
+  }
+  catch (...)
+  {
+  }
+  if (OwnsStream_)
+  {
+    fclose(Stream_);
+  }
+}
+
+void CsvSink::WriteHeader()
+{
+  if (!HeaderWritten_)
+  {
+    Out_.Append("scenario_id,year,total,interest,contribution\n");
+    HeaderWritten_ = true;
+  }
+}
+
+void CsvSink::WriteRow(unsigned Scenario, int Year, double Total, double Interest, double Contribution)
+{
+  Out_.AppendInteger(Scenario);
+  Out_.Append(',');
+  Out_.AppendInteger(Year);
+  Out_.Append(',');
+  Out_.AppendShortest(Total);
+  Out_.Append(',');
+  Out_.AppendShortest(Interest);
+  Out_.Append(',');
+  Out_.AppendShortest(Contribution);
+  Out_.Append('\n');
+}
+
+/*! \brief
+ * Scenario id written with the rows of the next projections.
+ */
+void CsvSink::SetScenario(unsigned Scenario)
+{
+  Scenario_ = Scenario;
+}
+
+/*! \brief
+ * Writes through Writer's thread, as TableSink::SetAsyncWriter does.
+ */
+void CsvSink::SetAsyncWriter(AsyncWriter* Writer)
+{
+  Out_.SetAsyncWriter(Writer);
+}
+
+/*! \brief
+ * Adds every row of a stored history, labelled as PrintContents labels
+ * them.
+ */
+void CsvSink::WriteHistory(unsigned Scenario, InvestmentData& History)
+{
+  WriteHeader();
+  for (int i = 0; i < History.Size(); ++i)
+  {
+    WriteRow(Scenario, History.YearAt(i), History.TotalAt(i), History.InterestAt(i), History.ContributionAt(i));
+  }
+}
+
+void CsvSink::Begin()
+{
+  WriteHeader();
+}
+
+void CsvSink::Row(const HistoryRow& Row)
+{
+  WriteRow(Scenario_, Row.Year, Row.Total, Row.Interest, Row.Contribution);
+}
+
+void CsvSink::End()
+{
+  Out_.Flush();
+}
+
+JsonBufferOutput::JsonBufferOutput(OutputBuffer& Out) :
+  Out_(Out)
+{
+}
+
+void JsonBufferOutput::write(const char* Text, size_t Length)
+{
+  Out_.Append(Text, Length);
+}
+
+/*! \brief
+ * Writes to a stream the caller keeps open.
+ */
+JsonSink::JsonSink(FILE* Stream) :
+  Stream_(Stream), OwnsStream_(false), Out_(Stream), Output_(Out_), Json_(Output_)
+{
+}
+
+/*! \brief
+ * Creates (or truncates) the file at Path.
+ */
+JsonSink::JsonSink(const std::string& Path) :
+  Stream_(OpenSinkFile(Path)), OwnsStream_(true), Out_(Stream_), Output_(Out_), Json_(Output_)
+{
+}
+
+//Destructor closes the array if Close was not called. Errors are lost
+//here; call Close first to see them.
+JsonSink::~JsonSink()
+{
+  try
+  {
+    Close();
+  }
+  catch (...)
+  {
+  }
+  if (OwnsStream_)
+  {
+    fclose(Stream_);
+  }
+}
+
+//Starts the array before the first row.
+void JsonSink::Open()
+{
+  if (Json_.depth() == 0)
+  {
+    if (Json_.complete())
+    {
+      throw std::logic_error("JSON output is already closed.");
+    }
+    Json_.beginArray();
+  }
+}
+
+void JsonSink::WriteRow(unsigned Scenario, int Year, double Total, double Interest, double Contribution)
+{
+  Json_.beginObject();
+  Json_.key("scenario_id").unsignedInteger(Scenario);
+  Json_.key("year").integer(Year);
+  Json_.key("total").number(Total);
+  Json_.key("interest").number(Interest);
+  Json_.key("contribution").number(Contribution);
+  Json_.endObject();
+}
+
+/*! \brief
+ * Scenario id written with the rows of the next projections.
+ */
+void JsonSink::SetScenario(unsigned Scenario)
+{
+  Scenario_ = Scenario;
+}
+
+/*! \brief
+ * Writes through Writer's thread, as TableSink::SetAsyncWriter does.
+ */
+void JsonSink::SetAsyncWriter(AsyncWriter* Writer)
+{
+  Out_.SetAsyncWriter(Writer);
+}
+
+/*! \brief
+ * Adds every row of a stored history, labelled as PrintContents labels
+ * them.
+ */
+void JsonSink::WriteHistory(unsigned Scenario, InvestmentData& History)
+{
+  Open();
+  for (int i = 0; i < History.Size(); ++i)
+  {
+    WriteRow(Scenario, History.YearAt(i), History.TotalAt(i), History.InterestAt(i), History.ContributionAt(i));
+  }
+}
+
+void JsonSink::Begin()
+{
+  Open();
+}
+
+void JsonSink::Row(const HistoryRow& Row)
+{
+  WriteRow(Scenario_, Row.Year, Row.Total, Row.Interest, Row.Contribution);
+}
+
+void JsonSink::End()
+{
+  Out_.Flush();
+}
+
+/*! \brief
+ * Ends the array, so the output is a complete document. A sink that got
+ * no rows writes an empty array.
+ */
+void JsonSink::Close()
+{
+  if (Json_.complete())
+  {
+    return;
+  }
+  Open();
+  Json_.endArray();
+  Out_.Append('\n');
+  Out_.Flush();
+}
+
+/*! \brief
+ * \param Capacity
+ * Rows to keep; older rows are overwritten. Must be at least one.
+ */
+RingBufferSink::RingBufferSink(size_t Capacity)
+{
+  if (Capacity == 0)
+  {
+    throw std::invalid_argument("Ring buffer needs room for at least one row.");
+  }
+  Rows_.resize(Capacity);
+}
+
+//A new projection starts with an empty buffer.
+void RingBufferSink::Begin()
+{
+  Next_ = 0;
+  Size_ = 0;
+  Seen_ = 0;
+}
+
+void RingBufferSink::Row(const HistoryRow& Row)
+{
+  Rows_[Next_] = Row;
+  Next_ = (Next_ + 1 == Rows_.size()) ? 0 : Next_ + 1;
+  if (Size_ < Rows_.size())
+  {
+    ++Size_;
+  }
+  ++Seen_;
+}
+
+//Rows currently held.
+size_t RingBufferSink::Size()
+{
+  return Size_;
+}
+
+//Rows received since Begin, including overwritten ones.
+size_t RingBufferSink::Seen()
+{
+  return Seen_;
+}
+
+/*! \brief
+ * Row by age, 0 being the oldest row still held.
+ */
+const HistoryRow& RingBufferSink::At(size_t Index)
+{
+  if (Index >= Size_)
+  {
+    throw std::out_of_range("Ring buffer row index past the newest row.");
+  }
+  return Rows_[(Next_ + Rows_.size() - Size_ + Index) % Rows_.size()];
+}
@@ -0,0 +1,166 @@
+/**********************************************************************/
+/*! \file  HistorySink.h
+ * \author Seth Peterson
+ * \date   2020-10-09
+ * \brief
+ *     Receivers for history rows as a projection produces them, so rows
+ *     can be printed, written or inspected without storing the whole
+ *     history first.
+ */
+/**********************************************************************/
+#ifndef HISTORYSINK_H
+#define HISTORYSINK_H
+
+#include "OutputBuffer.h" //Table rows are formatted without printf
+#include "../json/emitter.h" //JSON rows are streamed, not built as a Value
+#include <cstddef> //For size_t
+#include <cstdio> //For FILE
+#include <string> //File paths
+#include <vector> //Ring buffer storage
+
+class InvestmentData;
+
+/* One history row. Year is labelled the way PrintContents labels it. */
+struct HistoryRow
+{
+  int Year;
+  double Total;
+  double Interest;
+  double Contribution;
+};
+
+/* Gets Begin once, Row for every row in order, then End once. */
+class HistorySink
+{
+  public:
+    virtual ~HistorySink() = default;
+    virtual void Begin() {}
+    virtual void Row(const HistoryRow& Row) = 0;
+    virtual void End() {}
+};
+
+/* Writes rows in PrintHistory's table layout, to stdout by default. */
+class TableSink : public HistorySink
+{
+  protected:
+    FILE* Stream_;
+    OutputBuffer Out_;
+
+  public:
+    TableSink(FILE* Stream = stdout);
+    void SetAsyncWriter(AsyncWriter* Writer);
+    void Begin() override;
+    void Row(const HistoryRow& Row) override;
+    void End() override;
+};
+
+/* Table layout written to a file that the sink owns. */
+class FileSink : public TableSink
+{
+  public:
+    FileSink(const std::string& Path);
+    ~FileSink();
+
+    FileSink(const FileSink&) = delete;
+    FileSink& operator=(const FileSink&) = delete;
+};
+
+/* Comma separated rows for other programs to read. The columns are
+ * always scenario_id,year,total,interest,contribution and the header is
+ * written once, so many scenarios can share one file: set the scenario
+ * before each projection, or add stored histories with WriteHistory.
+ * Doubles are written in the shortest form that reads back exactly. */
+class CsvSink : public HistorySink
+{
+  private:
+    FILE* Stream_;
+    bool OwnsStream_;
+    OutputBuffer Out_;
+    unsigned Scenario_ = 0;
+    bool HeaderWritten_ = false;
+
+    void WriteHeader();
+    void WriteRow(unsigned Scenario, int Year, double Total, double Interest, double Contribution);
+
+  public:
+    CsvSink(FILE* Stream = stdout);
+    CsvSink(const std::string& Path);
+    ~CsvSink();
+
+    CsvSink(const CsvSink&) = delete;
+    CsvSink& operator=(const CsvSink&) = delete;
+
+    void SetScenario(unsigned Scenario);
+    void SetAsyncWriter(AsyncWriter* Writer);
+    void WriteHistory(unsigned Scenario, InvestmentData& History);
+    void Begin() override;
+    void Row(const HistoryRow& Row) override;
+    void End() override;
+};
+
+/* Feeds a Json::Emitter's text into an OutputBuffer. */
+class JsonBufferOutput : public Json::EmitterSink
+{
+  private:
+    OutputBuffer& Out_;
+
+  public:
+    JsonBufferOutput(OutputBuffer& Out);
+    void write(const char* Text, size_t Length) override;
+};
+
+/* The CSV columns as one JSON array of row objects,
+ * [{"scenario_id":0,"year":1,"total":...},...], streamed out as rows
+ * arrive, so memory use does not grow with the row count. Like CsvSink,
+ * many scenarios can share the array. Close (or the destructor) writes
+ * the closing bracket. */
+class JsonSink : public HistorySink
+{
+  private:
+    FILE* Stream_;
+    bool OwnsStream_;
+    OutputBuffer Out_;
+    JsonBufferOutput Output_;
+    Json::Emitter Json_;
+    unsigned Scenario_ = 0;
+
+    void Open();
+    void WriteRow(unsigned Scenario, int Year, double Total, double Interest, double Contribution);
+
+  public:
+    JsonSink(FILE* Stream = stdout);
+    JsonSink(const std::string& Path);
+    ~JsonSink();
+
+    JsonSink(const JsonSink&) = delete;
+    JsonSink& operator=(const JsonSink&) = delete;
+
+    void SetScenario(unsigned Scenario);
+    void SetAsyncWriter(AsyncWriter* Writer);
+    void WriteHistory(unsigned Scenario, InvestmentData& History);
+    void Begin() override;
+    void Row(const HistoryRow& Row) override;
+    void End() override;
+    void Close();
+};
+
+/* Keeps only the most recent Capacity rows, in constant memory. */
+class RingBufferSink : public HistorySink
+{
+  private:
+    std::vector<HistoryRow> Rows_;
+    size_t Next_ = 0;
+    size_t Size_ = 0;
+    size_t Seen_ = 0;
+
+  public:
+    RingBufferSink(size_t Capacity);
+    void Begin() override;
+    void Row(const HistoryRow& Row) override;
+
+    size_t Size();
+    size_t Seen();
+    const HistoryRow& At(size_t Index);
+};
+
+#endif
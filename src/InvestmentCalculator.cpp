@@ -8,9 +8,13 @@
  */
 /**********************************************************************/
 #include "InvestmentCalculator.h"
+#include "AffineScan.h" //For scheduled projections
+#include "HistorySink.h" //Rows streamed out of a projection
+#include "OutputBuffer.h" //For printing rows
 #include <cstdio> //For printf
 #include <stdexcept> //For exception handling when given bad input
-#include <cassert> //for assert on destructor
+#include <cmath> //For pow, expm1 and log1p in the closed form
+#include <vector> //Scratch totals for scheduled projections
 
   /*! \brief
    * Constructs the object and initializes its fields.
@@ -23,60 +27,621 @@
    * by interest the year it is added.
    */
 InvestmentCalculator::InvestmentCalculator(double InitialCapital, double InterestRate, double YearlyContribution) :
-    InitialCapital_(InitialCapital), InterestRate_(InterestRate), YearlyContribution_(YearlyContribution), History_(nullptr)
+    InitialCapital_(InitialCapital), InterestRate_(InterestRate), YearlyContribution_(YearlyContribution), History_(0, 1)
 {
+  BeginProjection();
 }
 
-InvestmentCalculator::~InvestmentCalculator()
+/*! \brief
+ * Simulates the growth of an investment without changing the internal variables.
+ * When the stored history already covers the same horizon, only the parts
+ * made stale by setter calls since the last projection are recomputed.
+ * \param YearsToPredict
+ * How many lines to display in the spreadsheet.
+ * \param RecordHistory
+ * When false no rows are kept and the result comes from the closed form,
+ * so the cost does not grow with the number of years. The stored history
+ * is emptied, so the print functions describe this projection from its
+ * summary. The None and Summary history policies behave the same way for
+ * every call.
+ * \return
+ * Size of the investment after the years have passed.
+ */
+double InvestmentCalculator::PredictGrowth(unsigned YearsToPredict, bool RecordHistory)
 {
-  if (History_ != nullptr)
+  bool KeepRows = RecordHistory && (Policy_ == HistoryPolicy::Full || Policy_ == HistoryPolicy::EveryNth);
+  if (!KeepRows)
   {
-    delete History_;
-    History_ = nullptr;
-    assert(!History_);
+    DiscardHistory();
+    if (ContributionChanges_.empty())
+    {
+      Summary_ = ProjectSummary(YearsToPredict);
+    }
+    else
+    {
+      BeginProjection();
+      ProjectYears(0, YearsToPredict, InitialCapital_, false);
+    }
+    return Summary_.FinalTotal;
   }
+
+  //Only yearly rows can be patched in place.
+  if (HistoryValid_ && Policy_ == HistoryPolicy::Full && HistoryYears_ == YearsToPredict && !RateDirty_)
+  {
+    UpdateHistory();
+    return Summary_.FinalTotal;
+  }
+
+  PrepareHistory(YearsToPredict / HistoryStride_ + (YearsToPredict % HistoryStride_ != 0));
+  BeginProjection();
+  ProjectYears(0, YearsToPredict, InitialCapital_, true);
+  FinishProjection(true);
+
+  HistoryYears_ = YearsToPredict;
+  HistoryValid_ = (Policy_ == HistoryPolicy::Full);
+  RateDirty_ = false;
+  CapitalDelta_ = 0.0;
+  ContributionDirtyFrom_ = YearsToPredict;
+  return Summary_.FinalTotal;
 }
 
 /*! \brief
- * Simulates the growth of an investment without changing the internal variables.
+ * Simulates the growth of an investment and hands each row to a sink as
+ * soon as it is computed. No rows are stored, so memory use does not
+ * depend on the number of years; the stored history is emptied, so the
+ * print functions describe this projection from its summary.
  * \param YearsToPredict
- * How many lines to display in the spreadsheet.
+ * How many years to project.
+ * \param Sink
+ * Gets a row per year, or per N years with the EveryNth history policy.
  * \return
  * Size of the investment after the years have passed.
  */
-double InvestmentCalculator::PredictGrowth(unsigned YearsToPredict)
+double InvestmentCalculator::PredictGrowth(unsigned YearsToPredict, HistorySink& Sink)
 {
-  unsigned current_year = 1;
-  double Capital = InitialCapital_;
+  DiscardHistory();
+  BeginProjection();
+  Sink_ = &Sink;
+  try
+  {
+    Sink.Begin();
+    ProjectYears(0, YearsToPredict, InitialCapital_, false);
+    FinishProjection(false);
+    Sink.End();
+  }
+  catch (...)
+  {
+    Sink_ = nullptr;
+    throw;
+  }
+  Sink_ = nullptr;
+  return Summary_.FinalTotal;
+}
 
-  //Calculate growth.
-  while(current_year <= YearsToPredict)
+//Walks years [FirstYear, LastYear) from the given capital.
+double InvestmentCalculator::ProjectYears(unsigned FirstYear, unsigned LastYear, double Capital, bool KeepRows)
+{
+  for (unsigned Year = FirstYear; Year < LastYear; ++Year)
   {
-    double Total = CalculateNextTotal(Capital, InterestRate_, YearlyContribution_);
+    double Contribution = ContributionForYear(Year);
+    double Total = CalculateNextTotal(Capital, AnnualFactor(InterestRate_), AnnualAddend(InterestRate_, Contribution));
     double Growth = Total - Capital;
-    double InterestGrowth = Growth - YearlyContribution_;
+    double InterestGrowth = Growth - Contribution;
 
     //Add information to history.
-    AddToHistory(Total, InterestGrowth, YearlyContribution_);
+    RecordYear(Total, InterestGrowth, Contribution, KeepRows);
 
     Capital = Total;
-    ++current_year;
   }
+  return Capital;
+}
+
+/*! \brief
+ * Brings a stored yearly history up to date with the setters. A capital
+ * change shifts every year by the delta compounded to that year; a
+ * contribution change recomputes only the years from the change onward.
+ */
+void InvestmentCalculator::UpdateHistory()
+{
+  if (CapitalDelta_ != 0.0)
+  {
+    History_.AddCompoundedDelta(CapitalDelta_, AnnualFactor(InterestRate_));
+    CapitalDelta_ = 0.0;
+  }
+
+  if (ContributionDirtyFrom_ < HistoryYears_)
+  {
+    unsigned FirstYear = ContributionDirtyFrom_;
+    History_.Truncate(FirstYear);
+    double Capital = (FirstYear == 0) ? InitialCapital_ : History_.TotalAt(FirstYear - 1);
+    ProjectYears(FirstYear, HistoryYears_, Capital, true);
+    ContributionDirtyFrom_ = HistoryYears_;
+  }
+
+  SummarizeHistory();
+}
+
+//Rebuilds the running totals from the stored yearly rows.
+void InvestmentCalculator::SummarizeHistory()
+{
+  BeginProjection();
+  if (History_.Size() > 0)
+  {
+    HistoryRange Whole = History_.Get(0, History_.Size());
+    Summary_.FinalTotal = Whole.EndTotal;
+    Summary_.TotalInterest = Whole.Interest;
+    Summary_.TotalContributions = Whole.Contributions;
+  }
+}
+
+/*! \brief
+ * Contribution made at the end of a year, after any scheduled changes.
+ * \param Year
+ * Zero based year of the projection.
+ */
+double InvestmentCalculator::ContributionForYear(unsigned Year)
+{
+  double Contribution = YearlyContribution_;
+  for (const ContributionChange& Change : ContributionChanges_)
+  {
+    if (Change.FromYear <= Year)
+    {
+      Contribution = Change.Amount;
+    }
+  }
+  return Contribution;
+}
+
+/*! \brief
+ * Computes the final total, interest and contributions of a projection
+ * without walking the years or touching the history.
+ * \param YearsToPredict
+ * Length of the projection.
+ * \return
+ * Summary of the projection after the years have passed.
+ */
+ProjectionSummary InvestmentCalculator::ProjectSummary(unsigned YearsToPredict)
+{
+  ProjectionSummary Summary = CalculateClosedFormTotal(InitialCapital_, AnnualFactor(InterestRate_), AnnualAddend(InterestRate_, YearlyContribution_), YearsToPredict);
+  //Interest is whatever the deposits did not provide.
+  Summary.TotalContributions = YearlyContribution_ * YearsToPredict;
+  Summary.TotalInterest = Summary.FinalTotal - InitialCapital_ - Summary.TotalContributions;
+  return Summary;
+}
+
+/*! \brief
+ * Growth multiplier of a whole year once sub-annual compounding is applied.
+ * The nominal rate is split evenly over the periods, and the per-period
+ * factor is raised to the number of periods by repeated squaring.
+ * \param Rate
+ * Nominal yearly growth multiplier (1.07 means 7% a year).
+ */
+double InvestmentCalculator::AnnualFactor(double Rate)
+{
+  if (CompoundingPeriods_ == 1)
+  {
+    return Rate;
+  }
+  double PeriodFactor = 1.0 + (Rate - 1.0) / CompoundingPeriods_;
+  return PowerBySquaring(PeriodFactor, CompoundingPeriods_);
+}
+
+/*! \brief
+ * Value at the end of a year of that year's contributions. The yearly
+ * amount is split into equal deposits, each one compounding for the
+ * periods left in the year after it is made.
+ * \param Rate
+ * Nominal yearly growth multiplier.
+ * \param Contribution
+ * Total deposited over the year.
+ */
+double InvestmentCalculator::AnnualAddend(double Rate, double Contribution)
+{
+  if (ContributionPeriods_ == 1)
+  {
+    return Contribution;
+  }
+  double PeriodFactor = 1.0 + (Rate - 1.0) / CompoundingPeriods_;
+  double DepositFactor = PowerBySquaring(PeriodFactor, CompoundingPeriods_ / ContributionPeriods_);
+  return CalculateClosedFormTotal(0.0, DepositFactor, Contribution / ContributionPeriods_, ContributionPeriods_).FinalTotal;
+}
+
+/*! \brief
+ * Simulates growth one compounding period at a time and records a row per
+ * period instead of per year. Yearly projections never need this, it is
+ * for callers that want to see every period.
+ * \param YearsToPredict
+ * Number of years; the history gets that many times the periods per year.
+ * \return
+ * Size of the investment after the years have passed.
+ */
+double InvestmentCalculator::PredictPeriodicGrowth(unsigned YearsToPredict)
+{
+  bool KeepRows = (Policy_ == HistoryPolicy::Full || Policy_ == HistoryPolicy::EveryNth);
+  PrepareHistory(KeepRows ? (YearsToPredict * CompoundingPeriods_) / HistoryStride_ + ((YearsToPredict * CompoundingPeriods_) % HistoryStride_ != 0) : 0);
+  HistoryValid_ = false;
+  BeginProjection();
+
+  unsigned PeriodsPerDeposit = CompoundingPeriods_ / ContributionPeriods_;
+  double PeriodFactor = (CompoundingPeriods_ == 1) ? InterestRate_ : 1.0 + (InterestRate_ - 1.0) / CompoundingPeriods_;
+  double Capital = InitialCapital_;
+
+  for (unsigned Year = 0; Year < YearsToPredict; ++Year)
+  {
+    double Deposit = ContributionForYear(Year) / ContributionPeriods_;
+    for (unsigned Period = 1; Period <= CompoundingPeriods_; ++Period)
+    {
+      double Contribution = (Period % PeriodsPerDeposit == 0) ? Deposit : 0.0;
+      double Total = CalculateNextTotal(Capital, PeriodFactor, Contribution);
+      RecordYear(Total, Total - Capital - Contribution, Contribution, KeepRows);
+      Capital = Total;
+    }
+  }
+  FinishProjection(KeepRows);
+  return Capital;
+}
+
+/*! \brief
+ * Simulates growth when the rate and contribution change from year to year.
+ * The initial capital is taken from the calculator, the stored rate and
+ * contribution are ignored in favour of the schedule.
+ * \param Rates
+ * Growth multiplier for each year.
+ * \param Contributions
+ * Amount added at the end of each year.
+ * \param YearsToPredict
+ * Length of both schedules.
+ * \param Pool
+ * Optional workers used to scan long schedules in parallel.
+ * \return
+ * Size of the investment after the years have passed.
+ */
+double InvestmentCalculator::PredictScheduledGrowth(const double* Rates, const double* Contributions, unsigned YearsToPredict, ThreadPool* Pool)
+{
+  if (YearsToPredict == 0)
+  {
+    return InitialCapital_;
+  }
+
+  std::vector<double> Totals(YearsToPredict);
+  ProjectSchedule(InitialCapital_, Rates, Contributions, YearsToPredict, Totals.data(), Pool);
+
+  bool KeepRows = (Policy_ == HistoryPolicy::Full || Policy_ == HistoryPolicy::EveryNth);
+  PrepareHistory(KeepRows ? YearsToPredict / HistoryStride_ + (YearsToPredict % HistoryStride_ != 0) : 0);
+  HistoryValid_ = false;
+  BeginProjection();
+  double Capital = InitialCapital_;
+  for (unsigned i = 0; i < YearsToPredict; ++i)
+  {
+    double InterestGrowth = Totals[i] - Capital - Contributions[i];
+    RecordYear(Totals[i], InterestGrowth, Contributions[i], KeepRows);
+    Capital = Totals[i];
+  }
+  FinishProjection(KeepRows);
 
   return Capital;
 }
 
+/*! \brief
+ * Finds the yearly contribution that reaches a target balance. The final
+ * total is linear in the contribution, so this is a direct inversion.
+ * \param TargetTotal
+ * Balance wanted at the end of the horizon.
+ * \param Years
+ * Length of the horizon, must be at least one year.
+ * \return
+ * Required yearly contribution. Negative when the capital alone overshoots
+ * the target, meaning that much can be withdrawn each year instead.
+ */
+double InvestmentCalculator::SolveYearlyContribution(double TargetTotal, unsigned Years)
+{
+  if (Years == 0)
+  {
+    throw std::invalid_argument("Contribution can only be solved over at least one year.");
+  }
+  double Factor = AnnualFactor(InterestRate_);
+  double CapitalOnly = CalculateClosedFormTotal(InitialCapital_, Factor, 0.0, Years).FinalTotal;
+  double PerUnitContribution = CalculateClosedFormTotal(0.0, Factor, AnnualAddend(InterestRate_, 1.0), Years).FinalTotal;
+  return (TargetTotal - CapitalOnly) / PerUnitContribution;
+}
+
+/*! \brief
+ * Finds the growth multiplier that reaches a target balance. There is no
+ * closed form, so Newton steps are taken inside a bracket that is shrunk
+ * every iteration; a step that leaves the bracket is replaced by bisection.
+ * \param TargetTotal
+ * Balance wanted at the end of the horizon.
+ * \param Years
+ * Length of the horizon, must be at least one year.
+ * \return
+ * Required growth multiplier (1.07 means 7% a year).
+ */
+double InvestmentCalculator::SolveInterestRate(double TargetTotal, unsigned Years)
+{
+  if (Years == 0)
+  {
+    throw std::invalid_argument("Interest rate can only be solved over at least one year.");
+  }
+  if (InitialCapital_ < 0 || YearlyContribution_ < 0 || InitialCapital_ + YearlyContribution_ <= 0)
+  {
+    throw std::domain_error("Interest rate can only be solved for growing, non-negative investments.");
+  }
+
+  //Final total and its derivative with respect to the rate, in one pass.
+  //With sub-annual compounding a central difference of the closed form
+  //stands in for the derivative.
+  auto Evaluate = [&](double Rate, double& Derivative)
+  {
+    if (CompoundingPeriods_ != 1)
+    {
+      auto Final = [&](double r) { return CalculateClosedFormTotal(InitialCapital_, AnnualFactor(r), AnnualAddend(r, YearlyContribution_), Years).FinalTotal; };
+      double Step = 1e-7 * (Rate + 1.0);
+      double Low = (Rate - Step > 0.0) ? Rate - Step : 0.0;
+      Derivative = (Final(Rate + Step) - Final(Low)) / (Rate + Step - Low);
+      return Final(Rate) - TargetTotal;
+    }
+    double Total = InitialCapital_;
+    Derivative = 0.0;
+    for (unsigned Year = 0; Year < Years; ++Year)
+    {
+      Derivative = Total + Rate * Derivative;
+      Total = CalculateNextTotal(Total, Rate, YearlyContribution_);
+    }
+    return Total - TargetTotal;
+  };
+
+  double Slope;
+  double Low = 0.0;
+  double High = 2.0;
+  if (Evaluate(Low, Slope) > 0)
+  {
+    throw std::domain_error("Target is below what the contributions alone produce.");
+  }
+  while (Evaluate(High, Slope) < 0)
+  {
+    Low = High;
+    High *= 2.0;
+    if (High > 1e6)
+    {
+      throw std::domain_error("Target cannot be reached with any reasonable rate.");
+    }
+  }
+
+  double Rate = (InterestRate_ > Low && InterestRate_ < High) ? InterestRate_ : 0.5 * (Low + High);
+  for (int Iteration = 0; Iteration < 100; ++Iteration)
+  {
+    double Error = Evaluate(Rate, Slope);
+    if (Error == 0.0)
+    {
+      break;
+    }
+    if (Error < 0)
+    {
+      Low = Rate;
+    }
+    else
+    {
+      High = Rate;
+    }
+
+    double Next = (Slope > 0) ? Rate - Error / Slope : Low;
+    if (Next <= Low || Next >= High)
+    {
+      Next = 0.5 * (Low + High);
+    }
+    if (std::fabs(Next - Rate) <= 1e-15 * Next)
+    {
+      Rate = Next;
+      break;
+    }
+    Rate = Next;
+  }
+  return Rate;
+}
+
+/*! \brief
+ * Finds how long it takes to reach a target balance. Solves
+ * r^n = (T(r-1) + c) / (C(r-1) + c) for n.
+ * \param TargetTotal
+ * Balance wanted.
+ * \return
+ * Fractional number of years; the ceiling is the first whole year at which
+ * the balance is at or above the target.
+ */
+double InvestmentCalculator::SolveYears(double TargetTotal)
+{
+  if (TargetTotal <= InitialCapital_)
+  {
+    return 0.0;
+  }
+
+  double Excess = AnnualFactor(InterestRate_) - 1.0;
+  double Addend = AnnualAddend(InterestRate_, YearlyContribution_);
+  if (Excess == 0.0)
+  {
+    if (Addend <= 0)
+    {
+      throw std::domain_error("Target is never reached without growth or contributions.");
+    }
+    return (TargetTotal - InitialCapital_) / Addend;
+  }
+
+  double Ratio = (TargetTotal * Excess + Addend) / (InitialCapital_ * Excess + Addend);
+  double Years = std::log(Ratio) / std::log1p(Excess);
+  if (!(Ratio > 0) || !(Years >= 0) || std::isinf(Years))
+  {
+    throw std::domain_error("Target is never reached with this rate and contribution.");
+  }
+  return Years;
+}
+
 /*! \brief
  * Adds one year's worth of history to the calculator's data object.
  * 
  */
 void InvestmentCalculator::AddToHistory(double Capital, double Interest, double Contribution)
 {
-  if (History_ == nullptr)
+  History_.Append(Capital, Interest, Contribution);
+}
+
+/*! \brief
+ * Empties the history and sizes it for the rows a projection is about to
+ * add, so the projection never grows its history while it runs. Short
+ * projections fit in the history's inline rows and allocate nothing.
+ * Longer ones make one arena allocation for all their chunks plus one
+ * heap allocation for the chunk index; without an arena every chunk is a
+ * separate heap allocation.
+ * \param Rows
+ * Rows the projection will add.
+ */
+void InvestmentCalculator::PrepareHistory(unsigned Rows)
+{
+  History_.Clear();
+  History_.Reserve(static_cast<int>(Rows));
+}
+
+//Empties the history of an earlier projection, keeping its storage, when
+//the projection about to run keeps no rows. Otherwise the print functions
+//would describe the earlier projection.
+void InvestmentCalculator::DiscardHistory()
+{
+  History_.Clear();
+  HistoryValid_ = false;
+}
+
+//Replaces the history with an empty one for the current stride and arena.
+void InvestmentCalculator::ResetHistory()
+{
+  //Strided rows are labelled with the last year they cover.
+  History_ = InvestmentData(HistoryStride_ - 1, HistoryStride_, Arena_);
+  HistoryValid_ = false;
+}
+
+/*! \brief
+ * Takes history row storage from an arena instead of the heap. Batch runs
+ * hand the same arena to many calculators and reset it once the batch is
+ * done; the calculators must not print or project again after that reset.
+ * A projection that outgrows the inline rows takes all of its chunks in
+ * one arena allocation. The small chunk index still lives on the heap.
+ * \param Arena
+ * Arena to allocate from, or nullptr to go back to the heap.
+ */
+void InvestmentCalculator::SetArena(HistoryArena* Arena)
+{
+  Arena_ = Arena;
+  ResetHistory();
+}
+
+/*! \brief
+ * Chooses how much PredictGrowth keeps while it runs.
+ * \param Policy
+ * See HistoryPolicy.
+ * \param Stride
+ * Years per history row for EveryNth, ignored otherwise.
+ */
+void InvestmentCalculator::SetHistoryPolicy(HistoryPolicy Policy, unsigned Stride)
+{
+  if (Policy == HistoryPolicy::EveryNth && Stride == 0)
+  {
+    throw std::invalid_argument("History stride must be at least one year.");
+  }
+  Policy_ = Policy;
+  HistoryStride_ = (Policy == HistoryPolicy::EveryNth) ? Stride : 1;
+  //Rows already stored were labelled for the old stride.
+  ResetHistory();
+}
+
+/*! \brief
+ * Exposes the current history policy.
+ */
+HistoryPolicy InvestmentCalculator::GetHistoryPolicy()
+{
+  return Policy_;
+}
+
+/*! \brief
+ * Totals of the most recent projection, kept under every history policy.
+ * \return
+ * Copy of the stored summary.
+ */
+ProjectionSummary InvestmentCalculator::GetSummary()
+{
+  return Summary_;
+}
+
+/*! \brief
+ * Exposes the rows kept by the last projection, for exporting them.
+ */
+InvestmentData& InvestmentCalculator::GetHistory()
+{
+  return History_;
+}
+
+//Resets the running totals before a projection walks its years.
+void InvestmentCalculator::BeginProjection()
+{
+  Summary_.FinalTotal = InitialCapital_;
+  Summary_.TotalInterest = 0.0;
+  Summary_.TotalContributions = 0.0;
+  GroupInterest_ = 0.0;
+  GroupContribution_ = 0.0;
+  GroupYears_ = 0;
+  YearsRecorded_ = 0;
+}
+
+//Feeds one projected year through the history policy.
+void InvestmentCalculator::RecordYear(double Total, double Interest, double Contribution, bool KeepRow)
+{
+  Summary_.FinalTotal = Total;
+  Summary_.TotalInterest += Interest;
+  Summary_.TotalContributions += Contribution;
+  ++YearsRecorded_;
+
+  if (!KeepRow && Sink_ == nullptr)
+  {
+    return;
+  }
+
+  GroupInterest_ += Interest;
+  GroupContribution_ += Contribution;
+  if (++GroupYears_ == HistoryStride_)
+  {
+    if (KeepRow)
+    {
+      AddToHistory(Total, GroupInterest_, GroupContribution_);
+    }
+    if (Sink_ != nullptr)
+    {
+      //Rows are labelled with the last year they cover, as in the history.
+      Sink_->Row(HistoryRow{static_cast<int>(YearsRecorded_) - 1, Total, GroupInterest_, GroupContribution_});
+    }
+    GroupInterest_ = 0.0;
+    GroupContribution_ = 0.0;
+    GroupYears_ = 0;
+  }
+}
+
+//Writes the years of an unfinished EveryNth group as one shorter row,
+//labelled with the last year it covers.
+void InvestmentCalculator::FinishProjection(bool KeepRows)
+{
+  if (GroupYears_ == 0 || (!KeepRows && Sink_ == nullptr))
+  {
+    return;
+  }
+  int LastYear = static_cast<int>(YearsRecorded_) - 1;
+  if (KeepRows)
   {
-    History_ = new InvestmentData();
+    AddToHistory(Summary_.FinalTotal, GroupInterest_, GroupContribution_);
+    History_.LabelLastRow(LastYear);
   }
-  History_->Append(Capital, Interest, Contribution);
+  if (Sink_ != nullptr)
+  {
+    Sink_->Row(HistoryRow{LastYear, Summary_.FinalTotal, GroupInterest_, GroupContribution_});
+  }
+  GroupInterest_ = 0.0;
+  GroupContribution_ = 0.0;
+  GroupYears_ = 0;
 }
 
 /*! \brief
@@ -84,7 +649,13 @@ void InvestmentCalculator::AddToHistory(double Capital, double Interest, double
  */
 void InvestmentCalculator::PrintInitialInvestment()
 {
-  printf("Initial Capital: %5.2f\nInterest Rate: %3.5f\n",InitialCapital_,InterestRate_-1.0);
+  OutputBuffer& Out = StandardOutput();
+  Out.Append("Initial Capital: ");
+  Out.AppendFixed(InitialCapital_, 2, 5);
+  Out.Append("\nInterest Rate: ");
+  Out.AppendFixed(InterestRate_ - 1.0, 5, 3);
+  Out.Append('\n');
+  Out.Flush();
 }
 
 /*! \brief
@@ -98,9 +669,18 @@ void InvestmentCalculator::PrintInitialInvestment()
  */
 void InvestmentCalculator::PrintInvestmentCumulativeRow(double Capital, double InterestGrowth, double Contribution)
 {
-  printf("-----------------Cumulative------------------------------\n");
-  PrintCumulativeLabelRow();
-  printf("%5.2f || %5.2f || %5.2f || %5.2f\n",Capital,InterestGrowth+Contribution,InterestGrowth,Contribution);
+  OutputBuffer& Out = StandardOutput();
+  Out.Append("-----------------Cumulative------------------------------\n");
+  Out.Append("   Total  | Growth | Interest | Contribution\n");
+  Out.AppendFixed(Capital, 2, 5);
+  Out.Append(" || ", 4);
+  Out.AppendFixed(InterestGrowth + Contribution, 2, 5);
+  Out.Append(" || ", 4);
+  Out.AppendFixed(InterestGrowth, 2, 5);
+  Out.Append(" || ", 4);
+  Out.AppendFixed(Contribution, 2, 5);
+  Out.Append('\n');
+  Out.Flush();
 }
 
 /*! \brief
@@ -114,6 +694,7 @@ void InvestmentCalculator::SetInitialCapital(double NewCapital)
   {
     throw std::invalid_argument("Capital must be a positive value.");
   }
+  CapitalDelta_ += NewCapital - InitialCapital_;
   InitialCapital_ = NewCapital;
 }
 /*! \brief
@@ -127,6 +708,7 @@ void InvestmentCalculator::SetInterestRate(double NewRate)
   {
     throw std::invalid_argument("Interest rate must be within 0-0.5 range.");
   }
+  RateDirty_ = RateDirty_ || (NewRate != InterestRate_);
   InterestRate_ = NewRate;
 }
 /*! \brief
@@ -138,6 +720,54 @@ void InvestmentCalculator::SetYearlyContribution(double NewContribution)
 {
   /* There is intentionally no checking here, as people may withdraw money yearly */
   YearlyContribution_ = NewContribution;
+  ContributionChanges_.clear();
+  ContributionDirtyFrom_ = 0;
+}
+/*! \brief
+ * Changes the yearly contribution from a given year onward, keeping the
+ * amounts of earlier years. Later changes replace earlier ones that start
+ * at or after the same year.
+ * \param NewContribution
+ * Amount added at the end of FromYear and every year after it.
+ * \param FromYear
+ * Zero based year of the first contribution at the new amount.
+ */
+void InvestmentCalculator::SetYearlyContribution(double NewContribution, unsigned FromYear)
+{
+  if (FromYear == 0)
+  {
+    SetYearlyContribution(NewContribution);
+    return;
+  }
+  while (!ContributionChanges_.empty() && ContributionChanges_.back().FromYear >= FromYear)
+  {
+    ContributionChanges_.pop_back();
+  }
+  ContributionChanges_.push_back(ContributionChange{FromYear, NewContribution});
+  if (FromYear < ContributionDirtyFrom_)
+  {
+    ContributionDirtyFrom_ = FromYear;
+  }
+}
+/*! \brief
+ * Sets how often interest compounds and contributions are deposited.
+ * The yearly rate is split evenly over the compounding periods and the
+ * yearly contribution evenly over the deposits.
+ * \param PeriodsPerYear
+ * Compounding periods per year, e.g. 12 for monthly or 365 for daily.
+ * \param ContributionsPerYear
+ * Deposits per year; must divide PeriodsPerYear so deposits land on
+ * period boundaries.
+ */
+void InvestmentCalculator::SetCompounding(unsigned PeriodsPerYear, unsigned ContributionsPerYear)
+{
+  if (PeriodsPerYear == 0 || ContributionsPerYear == 0 || PeriodsPerYear % ContributionsPerYear != 0)
+  {
+    throw std::invalid_argument("Contributions per year must evenly divide the compounding periods per year.");
+  }
+  RateDirty_ = RateDirty_ || PeriodsPerYear != CompoundingPeriods_ || ContributionsPerYear != ContributionPeriods_;
+  CompoundingPeriods_ = PeriodsPerYear;
+  ContributionPeriods_ = ContributionsPerYear;
 }
 /*! \brief
  * Exposes the current value of capital.
@@ -168,20 +798,29 @@ double InvestmentCalculator::GetYearlyContribution()
   return YearlyContribution_;
 }
 
-/* Prints contents from data object 
- * Can break if History_ is nullptr
+/* Prints contents from data object. Prints only the label row when
+ * nothing was recorded.
  */
 void InvestmentCalculator::PrintHistory()
 {
   PrintContentsLabelRow();
-  History_->PrintContents();
+  History_.PrintContents();
 }
 
-/* Gets the cumulative information from History. */
+/* Gets the cumulative information from History, or from the running
+ * summary when the history policy does not keep every year.
+ */
 void InvestmentCalculator::PrintCumulativeHistory()
 {
   PrintCumulativeLabelRow();
-  History_->PrintCumulative();
+  if (Policy_ == HistoryPolicy::Full && History_.Size() > 0)
+  {
+    History_.PrintCumulative();
+  }
+  else
+  {
+    PrintCumulativeRow(Summary_.FinalTotal, Summary_.TotalInterest, Summary_.TotalContributions);
+  }
 }
 
 /*! \brief
@@ -200,6 +839,65 @@ double CalculateNextTotal(double InitialCapital, double InterestRate, double Yea
   return InterestRate * InitialCapital + YearlyContribution;
 }
 
+/*! \brief
+ * Raises a number to a whole power with O(log n) multiplications.
+ * \param Base
+ * Number to raise.
+ * \param Exponent
+ * Whole power.
+ */
+double PowerBySquaring(double Base, unsigned Exponent)
+{
+  double Result = 1.0;
+  while (Exponent > 0)
+  {
+    if (Exponent & 1u)
+    {
+      Result *= Base;
+    }
+    Base *= Base;
+    Exponent >>= 1;
+  }
+  return Result;
+}
+
+/*! \brief
+ * Evaluates CalculateNextTotal applied Years times in constant time.
+ * The recurrence x -> r*x + c has the solution r^n*x + c*(r^n - 1)/(r - 1),
+ * which degenerates to x + n*c when the rate is exactly 1.
+ * \param InitialCapital
+ * Investment stored in the account in year 0.
+ * \param InterestRate
+ * Growth multiplier applied each year.
+ * \param YearlyContribution
+ * Flat amount added at the end of every year.
+ * \param Years
+ * Number of years to compound.
+ * \return
+ * Final total along with the interest and contributions that built it.
+ */
+ProjectionSummary CalculateClosedFormTotal(double InitialCapital, double InterestRate, double YearlyContribution, unsigned Years)
+{
+  double n = static_cast<double>(Years);
+  double Growth = 1.0;    //r^n
+  double SeriesSum = n;   //1 + r + ... + r^(n-1)
+
+  if (Years > 0 && InterestRate != 1.0)
+  {
+    //expm1/log1p keep precision when the rate is very close to 1.
+    double Excess = InterestRate - 1.0;
+    double GrowthMinusOne = (InterestRate > 0.0) ? std::expm1(n * std::log1p(Excess)) : std::pow(InterestRate, n) - 1.0;
+    Growth = GrowthMinusOne + 1.0;
+    SeriesSum = GrowthMinusOne / Excess;
+  }
+
+  ProjectionSummary Summary;
+  Summary.FinalTotal = Growth * InitialCapital + SeriesSum * YearlyContribution;
+  Summary.TotalContributions = n * YearlyContribution;
+  Summary.TotalInterest = Summary.FinalTotal - InitialCapital - Summary.TotalContributions;
+  return Summary;
+}
+
 /*! \brief
  *   This function prints the label row at the top of the predictions.
  */
@@ -210,13 +908,24 @@ double CalculateNextTotal(double InitialCapital, double InterestRate, double Yea
  */
 void PrintInvestmentInformation(int year, double Total, double InterestGrowth, double Contribution)
 {
-  printf("%5i: %5.2f || %5.2f || %5.2f || %5.2f\n",year,Total,InterestGrowth+Contribution,InterestGrowth,Contribution);
+  OutputBuffer& Out = StandardOutput();
+  Out.AppendInteger(year, 5);
+  Out.Append(": ", 2);
+  Out.AppendFixed(Total, 2, 5);
+  Out.Append(" || ", 4);
+  Out.AppendFixed(InterestGrowth + Contribution, 2, 5);
+  Out.Append(" || ", 4);
+  Out.AppendFixed(InterestGrowth, 2, 5);
+  Out.Append(" || ", 4);
+  Out.AppendFixed(Contribution, 2, 5);
+  Out.Append('\n');
+  Out.Flush();
 }
 
 
 /* This function prints useful information in the console window */
 void PrintHelp()
 {
-  printf("InvestmentCalculator can be used the following ways:\n  1. ./InvestmentPredictor.exe -> Enter only the program's name, and it tries to pull information from Input.json\n  2. ./InvestmentPredictor.exe [filename.json] -> Provide it with a json file and it will attempt to read it.\n  3. ./InvestmentPredictor.exe [InitialCapital] [Interest] [Yearly Contribution] [Years to predict] -> Enter in four arguments in the command line to perform the same calculations.\n");
+  printf("InvestmentCalculator can be used the following ways:\n  1. ./InvestmentPredictor.exe -> Enter only the program's name, and it tries to pull information from Input.json\n  2. ./InvestmentPredictor.exe [filename.json] -> Provide it with a json file and it will attempt to read it.\n  3. ./InvestmentPredictor.exe [InitialCapital] [Interest] [Yearly Contribution] [Years to predict] -> Enter in four arguments in the command line to perform the same calculations.\n  4. ./InvestmentPredictor.exe sweep [filename.json] -> Evaluate every combination of the Start/Step/Count ranges given for Capital, Interest, Contribution and Years (see Sweep.json).\n  Add --csv to any of these to print comma separated values (scenario_id first), or --json to print a JSON array of row objects, instead of the table.\n");
 }
 
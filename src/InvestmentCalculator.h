@@ -7,31 +7,123 @@
  *     showing the progression of an investment on a yearly basis.
  */
 /**********************************************************************/
+#ifndef INVESTMENTCALCULATOR_H
+#define INVESTMENTCALCULATOR_H
 
 #include "InvestmentData.h" //Data object for history.
+#include <vector> //Contribution changes
 
+class ThreadPool;
+class HistoryArena;
+class HistorySink;
+class ProjectionIterator;
+
+/* Final state of a projection, without any per-year history. */
+struct ProjectionSummary
+{
+  double FinalTotal;
+  double TotalInterest;
+  double TotalContributions;
+};
+
+/* What PredictGrowth keeps while it runs.
+ * Full     - one history row per year.
+ * None     - nothing but the returned total.
+ * Summary  - only the running totals exposed by GetSummary.
+ * EveryNth - one history row per N years, covering all N of them. When
+ *            the years do not divide by N, a last row covers the rest. */
+enum class HistoryPolicy
+{
+  Full,
+  None,
+  Summary,
+  EveryNth
+};
+
+/* Calculators are plain values: copying one copies its history and moving
+ * one hands the history's storage over without touching the rows. */
 class InvestmentCalculator
 {
+  //Walks the same yearly recurrence as ProjectYears, one year at a time.
+  friend class ProjectionIterator;
+
   private:
     double InitialCapital_;
     double InterestRate_;
     double YearlyContribution_;
-    InvestmentData* History_;
+    InvestmentData History_;
+    HistoryArena* Arena_ = nullptr;
+
+    unsigned CompoundingPeriods_ = 1;
+    unsigned ContributionPeriods_ = 1;
+
+    HistoryPolicy Policy_ = HistoryPolicy::Full;
+    unsigned HistoryStride_ = 1;
+    ProjectionSummary Summary_;
+    double GroupInterest_ = 0.0;
+    double GroupContribution_ = 0.0;
+    unsigned GroupYears_ = 0;
+    unsigned YearsRecorded_ = 0;
+    HistorySink* Sink_ = nullptr;
+
+    //Contribution that applies from FromYear onward, until a later change.
+    struct ContributionChange
+    {
+      unsigned FromYear;
+      double Amount;
+    };
+    std::vector<ContributionChange> ContributionChanges_;
+
+    //Dirty tracking for the stored history.
+    unsigned HistoryYears_ = 0;
+    bool HistoryValid_ = false;
+    bool RateDirty_ = false;
+    double CapitalDelta_ = 0.0;
+    unsigned ContributionDirtyFrom_ = 0;
+
+    double AnnualFactor(double Rate);
+    double AnnualAddend(double Rate, double Contribution);
+
+    void PrepareHistory(unsigned Rows);
+    void DiscardHistory();
+    void ResetHistory();
+    void BeginProjection();
+    void RecordYear(double Total, double Interest, double Contribution, bool KeepRow);
+    void FinishProjection(bool KeepRows);
+    double ProjectYears(unsigned FirstYear, unsigned LastYear, double Capital, bool KeepRows);
+    double ContributionForYear(unsigned Year);
+    void UpdateHistory();
+    void SummarizeHistory();
 
   public:
 
     InvestmentCalculator(double InitialCapital, double InterestRate, double YearlyContribution = 1.0);
-    ~InvestmentCalculator();
 
-    double PredictGrowth(unsigned YearsToPredict);
+    double PredictGrowth(unsigned YearsToPredict, bool RecordHistory = true);
+    double PredictGrowth(unsigned YearsToPredict, HistorySink& Sink);
+    ProjectionSummary ProjectSummary(unsigned YearsToPredict);
+    double PredictPeriodicGrowth(unsigned YearsToPredict);
+    double PredictScheduledGrowth(const double* Rates, const double* Contributions, unsigned YearsToPredict, ThreadPool* Pool = nullptr);
     void AddToHistory(double Capital, double Interest, double Contribution);
 
+    void SetHistoryPolicy(HistoryPolicy Policy, unsigned Stride = 1);
+    HistoryPolicy GetHistoryPolicy();
+    ProjectionSummary GetSummary();
+    InvestmentData& GetHistory();
+    void SetArena(HistoryArena* Arena);
+
+    double SolveYearlyContribution(double TargetTotal, unsigned Years);
+    double SolveInterestRate(double TargetTotal, unsigned Years);
+    double SolveYears(double TargetTotal);
+
     void PrintInitialInvestment();
     void PrintInvestmentCumulativeRow(double Capital, double InterestGrowth, double Contribution);
 
     void SetInitialCapital(double NewCapital);
     void SetInterestRate(double NewRate);
     void SetYearlyContribution(double NewContribution);
+    void SetYearlyContribution(double NewContribution, unsigned FromYear);
+    void SetCompounding(unsigned PeriodsPerYear, unsigned ContributionsPerYear = 1);
     double GetInitialCapital();
     double GetInterestRate();
     double GetYearlyContribution();
@@ -41,8 +133,11 @@ class InvestmentCalculator
 };
 
 double CalculateNextTotal(double InitialCapital, double InterestRate, double YearlyContribution);
+double PowerBySquaring(double Base, unsigned Exponent);
+ProjectionSummary CalculateClosedFormTotal(double InitialCapital, double InterestRate, double YearlyContribution, unsigned Years);
 
 void PrintHelp();
 
 void PrintInvestmentInformation(int year, double InitialCapital, double InterestGrowth, double Contribution);
 
+#endif
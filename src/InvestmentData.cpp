@@ -6,97 +6,480 @@
  */
 /**********************************************************************/
 #include "InvestmentData.h"
-#include <cstdio> //For printf
-#include <cassert> //for assert on destructor
+#include "HistoryArena.h" //Optional source of chunk storage
+#include "OutputBuffer.h" //For printing rows
+#include <algorithm> //For copy and min
+#include <new> //For aligned operator new
+
+//Chunks start on cache line boundaries; with 64 rows so does every column.
+static const int ChunkAlignment = 64;
+static const int ChunkShift = 6;
+static_assert(InvestmentData::ChunkRows == (1 << ChunkShift), "Row lookups shift by ChunkShift.");
+static_assert(InvestmentData::InlineRows * sizeof(double) % ChunkAlignment == 0, "Inline columns start on cache lines.");
+static_assert(InvestmentData::ChunkRows % 4 == 0 && InvestmentData::InlineRows % 4 == 0, "AddCompoundedDelta runs four rows at a time.");
+
+//Column order inside a chunk. The inline block holds only the first
+//InlineColumns of them.
+enum ColumnSlot
+{
+  TotalSlot,
+  InterestSlot,
+  ContributionSlot,
+  InterestPrefixSlot,
+  ContributionPrefixSlot
+};
+
+//Default constructor
+InvestmentData::InvestmentData() :
+  CurrentIndex_(0), StartYear_(0)
+{
+}
+
+//Specific constructor - allows for a start year, for rows that are more
+//than one year apart, and for storage taken from an arena that must
+//outlive this object.
+InvestmentData::InvestmentData(int StartYear, int YearStep, HistoryArena* Arena) :
+  CurrentIndex_(0), StartYear_(StartYear), YearStep_(YearStep), Arena_(Arena)
+{
+}
+
+//Copy constructor - copies the rows into storage of its own.
+InvestmentData::InvestmentData(const InvestmentData& Other) :
+  InvestmentData(Other.StartYear_, Other.YearStep_, Other.Arena_)
+{
+  CopyRows(Other);
+}
+
+//Move constructor - takes over the chunk index, copies the used inline rows.
+InvestmentData::InvestmentData(InvestmentData&& Other) noexcept :
+  InvestmentData(Other.StartYear_, Other.YearStep_, Other.Arena_)
+{
+  TakeRows(Other);
+}
+
+InvestmentData& InvestmentData::operator=(const InvestmentData& Other)
+{
+  if (this != &Other)
+  {
+    ReleaseChunks();
+    StartYear_ = Other.StartYear_;
+    YearStep_ = Other.YearStep_;
+    Arena_ = Other.Arena_;
+    CopyRows(Other);
+  }
+  return *this;
+}
+
+InvestmentData& InvestmentData::operator=(InvestmentData&& Other) noexcept
+{
+  if (this != &Other)
+  {
+    ReleaseChunks();
+    StartYear_ = Other.StartYear_;
+    YearStep_ = Other.YearStep_;
+    Arena_ = Other.Arena_;
+    TakeRows(Other);
+  }
+  return *this;
+}
+
+//Destructor makes sure that the chunks are released
+InvestmentData::~InvestmentData()
+{
+  ReleaseChunks();
+}
+
+//First column of a row, in the inline block or a chunk, and the distance
+//between its columns. Stride rows from the block's first row share it.
+double* InvestmentData::RowStart(int Row, int& Stride)
+{
+  if (Row < InlineRows)
+  {
+    Stride = InlineRows;
+    return Inline_ + Row;
+  }
+  Row -= InlineRows;
+  Stride = ChunkRows;
+  return Chunks_[Row >> ChunkShift] + (Row & (ChunkRows - 1));
+}
+
+//One column of one row.
+double& InvestmentData::Cell(int Column, int Row)
+{
+  int Stride;
+  return RowStart(Row, Stride)[Column * Stride];
+}
+
+//Running sum of the interest or contribution column through Row. Chunks
+//store it; inside the inline block it is summed in row order, which gives
+//the same value a stored running sum would.
+double InvestmentData::Prefix(int Column, int Row)
+{
+  if (Row >= InlineRows)
+  {
+    return Cell((Column == InterestSlot) ? InterestPrefixSlot : ContributionPrefixSlot, Row);
+  }
+  const double* Values = Inline_ + Column * InlineRows;
+  double Sum = 0;
+  for (int i = 0; i <= Row; ++i)
+  {
+    Sum += Values[i];
+  }
+  return Sum;
+}
+
+//Rows that fit without adding a chunk.
+int InvestmentData::Capacity()
+{
+  return InlineRows + static_cast<int>(Chunks_.size()) * ChunkRows;
+}
+
+//Adds one chunk at the end of the index, from the arena when there is one.
+void InvestmentData::AddChunk()
+{
+  size_t Bytes = sizeof(double) * ColumnCount * ChunkRows;
+  void* Block;
+  if (Arena_ != nullptr)
+  {
+    Block = Arena_->Allocate(Bytes, ChunkAlignment);
+  }
+  else
+  {
+    Block = ::operator new(Bytes, std::align_val_t(ChunkAlignment));
+  }
+  Chunks_.push_back(static_cast<double*>(Block));
+}
+
+//Releases every chunk. Arena chunks are only
+//reclaimed by resetting the arena.
+void InvestmentData::ReleaseChunks()
+{
+  if (Arena_ == nullptr)
+  {
+    for (double* Block : Chunks_)
+    {
+      ::operator delete(Block, std::align_val_t(ChunkAlignment));
+    }
+  }
+  Chunks_.clear();
+  CurrentIndex_ = 0;
+}
+
+//Copies every row of another history, which must be empty here.
+void InvestmentData::CopyRows(const InvestmentData& Other)
+{
+  Reserve(Other.CurrentIndex_);
+  int Stride;
+  for (int First = 0; First < Other.CurrentIndex_; First += Stride)
+  {
+    const double* Source = (First < InlineRows) ? Other.Inline_ : Other.Chunks_[(First - InlineRows) >> ChunkShift];
+    double* Target = RowStart(First, Stride);
+    int Rows = std::min(Stride, Other.CurrentIndex_ - First);
+    int Columns = (First < InlineRows) ? InlineColumns : ColumnCount;
+    for (int Column = 0; Column < Columns; ++Column)
+    {
+      std::copy(Source + Column * Stride, Source + Column * Stride + Rows, Target + Column * Stride);
+    }
+  }
+  CurrentIndex_ = Other.CurrentIndex_;
+  ShortLastRow_ = Other.ShortLastRow_;
+  LastRowYear_ = Other.LastRowYear_;
+}
+
+//Moves the rows of another history here and leaves it empty. Only the
+//inline rows are copied; every chunk changes owner in place.
+void InvestmentData::TakeRows(InvestmentData& Other)
+{
+  int Rows = std::min(InlineRows, Other.CurrentIndex_);
+  for (int Column = 0; Column < InlineColumns; ++Column)
+  {
+    std::copy(Other.Inline_ + Column * InlineRows, Other.Inline_ + Column * InlineRows + Rows, Inline_ + Column * InlineRows);
+  }
+  Chunks_ = std::move(Other.Chunks_);
+  CurrentIndex_ = Other.CurrentIndex_;
+  ShortLastRow_ = Other.ShortLastRow_;
+  LastRowYear_ = Other.LastRowYear_;
+  Other.Chunks_.clear();
+  Other.CurrentIndex_ = 0;
+  Other.ShortLastRow_ = false;
+}
+
+void InvestmentData::Append(double Total, double InterestEarnings, double Contributions)
+{
+  //A short row can only end the history.
+  ShortLastRow_ = false;
+  //Add another chunk if we're already full; stored rows stay where they are.
+  if (CurrentIndex_ == Capacity())
+  {
+    AddChunk();
+  }
+  int Stride;
+  double* Row = RowStart(CurrentIndex_, Stride);
+  Row[TotalSlot * Stride] = Total;
+  Row[InterestSlot * Stride] = InterestEarnings;
+  Row[ContributionSlot * Stride] = Contributions;
+  //Extend the running sums by one row; inline rows have none.
+  if (CurrentIndex_ >= InlineRows)
+  {
+    Row[InterestPrefixSlot * Stride] = Prefix(InterestSlot, CurrentIndex_-1) + InterestEarnings;
+    Row[ContributionPrefixSlot * Stride] = Prefix(ContributionSlot, CurrentIndex_-1) + Contributions;
+  }
+  ++CurrentIndex_;
+
+}
 
 /*! \brief
- * Default constructor.
- * \param 
+ * Drops every row from Rows onward, keeping the storage for reuse.
  */
-InvestmentData::YearlyData::YearlyData() :
-  AnnualTotal(0), AnnualInterestEarnings(0), AnnualContributions(0)
+void InvestmentData::Truncate(int Rows)
 {
+  if (Rows < CurrentIndex_)
+  {
+    CurrentIndex_ = (Rows < 0) ? 0 : Rows;
+    ShortLastRow_ = false;
+  }
 }
+
 /*! \brief
- * Constructs the object and initializes its fields.
- * \param 
+ * Drops every row, keeping the storage for reuse.
  */
-InvestmentData::YearlyData::YearlyData(double Total, double Interest, double Contribution) :
-  AnnualTotal(Total), AnnualInterestEarnings(Interest), AnnualContributions(Contribution)
+void InvestmentData::Clear()
 {
+  CurrentIndex_ = 0;
+  ShortLastRow_ = false;
 }
 
-//Default constructor
-InvestmentData::InvestmentData() :
-  Portfolio_(nullptr), CurrentIndex_(0), PortfolioSize_(0), StartYear_(0)
+/*! \brief
+ * Labels the last row with Year instead of its place in the steps, for a
+ * final row that covers fewer years than YearStep. Appending another row
+ * or truncating drops the label.
+ */
+void InvestmentData::LabelLastRow(int Year)
 {
+  if (CurrentIndex_ > 0)
+  {
+    ShortLastRow_ = true;
+    LastRowYear_ = Year;
+  }
 }
 
-//Specific constructor - allows for a start year.
-InvestmentData::InvestmentData(int StartYear) :
-  Portfolio_(nullptr), CurrentIndex_(0), PortfolioSize_(0), StartYear_(StartYear)
+/*! \brief
+ * Adjusts every row for a change of the starting capital. Row i moves by
+ * Delta * Rate^(i+1), and its interest by the growth of that shift over
+ * the year. Four independent running products keep the loop free of a
+ * single long dependency chain; they carry on from block to block.
+ * \param Delta
+ * Change of the initial capital.
+ * \param Rate
+ * Growth multiplier the rows were projected with.
+ */
+void InvestmentData::AddCompoundedDelta(double Delta, double Rate)
 {
+  double Rate2 = Rate * Rate;
+  double Rate4 = Rate2 * Rate2;
+  double Before[4] = {Delta, Delta * Rate, Delta * Rate2, Delta * Rate2 * Rate};
+
+  int Stride;
+  for (int First = 0; First < CurrentIndex_; First += Stride)
+  {
+    double* Block = RowStart(First, Stride);
+    double* Totals = Block + TotalSlot * Stride;
+    double* Interest = Block + InterestSlot * Stride;
+    int Rows = std::min(Stride, CurrentIndex_ - First);
+
+    int i = 0;
+    for (; i + 4 <= Rows; i += 4)
+    {
+      for (int Lane = 0; Lane < 4; ++Lane)
+      {
+        double After = Before[Lane] * Rate;
+        Totals[i + Lane] += After;
+        Interest[i + Lane] += After - Before[Lane];
+        Before[Lane] *= Rate4;
+      }
+    }
+    //Only the last block can end part way through a group of four.
+    for (int Lane = 0; i < Rows; ++i, ++Lane)
+    {
+      double After = Before[Lane] * Rate;
+      Totals[i] += After;
+      Interest[i] += After - Before[Lane];
+    }
+  }
+  RebuildInterestPrefix();
 }
-//Destructor makes sure that the data in portfolio is released
-InvestmentData::~InvestmentData()
+
+//Recomputes the stored interest running sums after rows were changed in
+//place.
+void InvestmentData::RebuildInterestPrefix()
 {
-  if (Portfolio_ != nullptr)
+  double Sum = 0;
+  int Stride;
+  for (int First = 0; First < CurrentIndex_; First += Stride)
   {
-    delete Portfolio_;
-    Portfolio_ = nullptr;
-    assert(!Portfolio_);
+    double* Block = RowStart(First, Stride);
+    int Rows = std::min(Stride, CurrentIndex_ - First);
+    for (int i = 0; i < Rows; ++i)
+    {
+      Sum += Block[InterestSlot * Stride + i];
+      if (First >= InlineRows)
+      {
+        Block[InterestPrefixSlot * Stride + i] = Sum;
+      }
+    }
   }
 }
 
-void InvestmentData::Append(double Total, double InterestEarnings, double Contributions)
+/*! \brief
+ * Summarizes a window of rows from the running sums, adding up at most
+ * InlineRows values for rows in the inline block.
+ * \param StartIndex
+ * First row of the window.
+ * \param EndIndex
+ * One past the last row of the window; 0 means through the last row.
+ * \return
+ * Balance at the end of the window and the growth, interest and
+ * contributions that happened inside it. All zero for an empty window.
+ */
+HistoryRange InvestmentData::Get(int StartIndex, int EndIndex)
 {
-  //Add more storage space if we're already full.
-  if (CurrentIndex_ == PortfolioSize_)
+  if (EndIndex == 0 || EndIndex > CurrentIndex_)
+  {
+    EndIndex = CurrentIndex_;
+  }
+  if (StartIndex < 0)
+  {
+    StartIndex = 0;
+  }
+
+  HistoryRange Range = {0.0, 0.0, 0.0, 0.0};
+  if (StartIndex >= EndIndex)
   {
-    Resize();
+    return Range;
   }
-  Portfolio_[CurrentIndex_++] = YearlyData(Total,InterestEarnings,Contributions);
+  Range.EndTotal = Cell(TotalSlot, EndIndex-1);
+  Range.Interest = Prefix(InterestSlot, EndIndex-1) - ((StartIndex > 0) ? Prefix(InterestSlot, StartIndex-1) : 0.0);
+  Range.Contributions = Prefix(ContributionSlot, EndIndex-1) - ((StartIndex > 0) ? Prefix(ContributionSlot, StartIndex-1) : 0.0);
+  Range.Growth = Range.Interest + Range.Contributions;
+  return Range;
+}
 
+//Number of rows stored.
+int InvestmentData::Size()
+{
+  return CurrentIndex_;
 }
 
-void InvestmentData::Resize()
+//Year label of a row, as printed by PrintContents.
+int InvestmentData::YearAt(int Index)
 {
-  if (PortfolioSize_ == 0)
+  if (ShortLastRow_ && Index == CurrentIndex_ - 1)
   {
-    //Create an array of size 8 once there's something to store.
-    Portfolio_ = new YearlyData [1];
-    PortfolioSize_ = 1;
-  } else {
-    //Double the size of the container as needed.
-    YearlyData* replacement = new YearlyData[PortfolioSize_*2];
-    for (int i=0; i<PortfolioSize_; ++i)
+    return LastRowYear_;
+  }
+  return StartYear_ + Index * YearStep_;
+}
+
+//Label of the first row on the steps.
+int InvestmentData::StartYear()
+{
+  return StartYear_;
+}
+
+//Years between consecutive row labels.
+int InvestmentData::YearStep()
+{
+  return YearStep_;
+}
+
+//Balance at the end of a stored row.
+double InvestmentData::TotalAt(int Index)
+{
+  return Cell(TotalSlot, Index);
+}
+
+//Interest earned during a stored row.
+double InvestmentData::InterestAt(int Index)
+{
+  return Cell(InterestSlot, Index);
+}
+
+//Contributions made during a stored row.
+double InvestmentData::ContributionAt(int Index)
+{
+  return Cell(ContributionSlot, Index);
+}
+
+/*! \brief
+ * Makes room for at least Rows rows up front, so a projection of known
+ * length never has to grow while it runs. The chunk index is sized once.
+ * With an arena every new chunk comes from one arena allocation; on the
+ * heap each chunk is its own allocation, since chunks are freed one by
+ * one.
+ */
+void InvestmentData::Reserve(int Rows)
+{
+  if (Rows <= Capacity())
+  {
+    return;
+  }
+  size_t Chunks = static_cast<size_t>((Rows - InlineRows + ChunkRows - 1) / ChunkRows);
+  size_t Added = Chunks - Chunks_.size();
+  Chunks_.reserve(Chunks);
+  if (Arena_ != nullptr)
+  {
+    //One arena block, cut into chunks, keeps this a single allocation.
+    size_t Bytes = sizeof(double) * ColumnCount * ChunkRows;
+    char* Block = static_cast<char*>(Arena_->Allocate(Bytes * Added, ChunkAlignment));
+    for (size_t i = 0; i < Added; ++i)
+    {
+      Chunks_.push_back(reinterpret_cast<double*>(Block + i * Bytes));
+    }
+  }
+  else
+  {
+    while (Rows > Capacity())
     {
-      replacement[i].AnnualTotal = Portfolio_[i].AnnualTotal;
-      replacement[i].AnnualInterestEarnings = Portfolio_[i].AnnualInterestEarnings;
-      replacement[i].AnnualContributions = Portfolio_[i].AnnualContributions;
+      AddChunk();
     }
-    //Get rid of duplicate data.
-    delete Portfolio_;
-    //Assign the data where it needs to go.
-    Portfolio_ = replacement;
-    PortfolioSize_ *= 2;
   }
 }
 
 void PrintContentsLabelRow()
 {
-  printf("Year  :   Total  || Growth   |  Interest | Contribution\n");
+  OutputBuffer& Out = StandardOutput();
+  Out.Append("Year  :   Total  || Growth   |  Interest | Contribution\n");
+  Out.Flush();
 }
 
 /* Print all the arrays as a series of rows. NOTE: IT IGNORES EMPTY SPACES
- * AT THE END! */
+ * AT THE END! Rows are collected and written together. */
 void InvestmentData::PrintContents()
 {
+  OutputBuffer& Out = StandardOutput();
   for(int i=0; i<CurrentIndex_; ++i)
   {
-    YearlyData abrv = Portfolio_[i];
-    printf("%5i : %5.2f || %5.2f = %5.2f + %5.2f\n",StartYear_+i,abrv.AnnualTotal,abrv.AnnualInterestEarnings+abrv.AnnualContributions,abrv.AnnualInterestEarnings,abrv.AnnualContributions);
+    AppendContentsRow(Out, YearAt(i), Cell(TotalSlot, i), Cell(InterestSlot, i), Cell(ContributionSlot, i));
   }
+  Out.Flush();
+}
+
+/*! \brief
+ *   Adds one row in PrintContents' layout, the same text as
+ *   "%5i : %5.2f || %5.2f = %5.2f + %5.2f\n".
+ */
+void AppendContentsRow(OutputBuffer& Out, int Year, double Total, double Interest, double Contribution)
+{
+  Out.AppendInteger(Year, 5);
+  Out.Append(" : ", 3);
+  Out.AppendFixed(Total, 2, 5);
+  Out.Append(" || ", 4);
+  Out.AppendFixed(Interest + Contribution, 2, 5);
+  Out.Append(" = ", 3);
+  Out.AppendFixed(Interest, 2, 5);
+  Out.Append(" + ", 3);
+  Out.AppendFixed(Contribution, 2, 5);
+  Out.Append('\n');
 }
 
 /*! \brief
@@ -105,17 +488,30 @@ void InvestmentData::PrintContents()
  */
 void PrintCumulativeLabelRow()
 {
-  printf("   Total  | Growth | Interest | Contribution\n");
+  OutputBuffer& Out = StandardOutput();
+  Out.Append("   Total  | Growth | Interest | Contribution\n");
+  Out.Flush();
 }
 
 void InvestmentData::PrintCumulative()
 {
-  double InterestTotal = 0;
-  double ContributionTotal = 0;
-  for(int i=0; i<CurrentIndex_; ++i)
-  {
-    InterestTotal += Portfolio_[i].AnnualInterestEarnings;
-    ContributionTotal += Portfolio_[i].AnnualContributions;
-  }
-  printf("%5.2f || %5.2f = %5.2f + %5.2f\n",Portfolio_[CurrentIndex_-1].AnnualTotal,InterestTotal+ContributionTotal, InterestTotal, ContributionTotal);
+  HistoryRange Whole = Get(0, CurrentIndex_);
+  PrintCumulativeRow(Whole.EndTotal, Whole.Interest, Whole.Contributions);
+}
+
+/*! \brief
+ *   This function prints the cumulative entry itself.
+ */
+void PrintCumulativeRow(double Total, double InterestTotal, double ContributionTotal)
+{
+  OutputBuffer& Out = StandardOutput();
+  Out.AppendFixed(Total, 2, 5);
+  Out.Append(" || ", 4);
+  Out.AppendFixed(InterestTotal + ContributionTotal, 2, 5);
+  Out.Append(" = ", 3);
+  Out.AppendFixed(InterestTotal, 2, 5);
+  Out.Append(" + ", 3);
+  Out.AppendFixed(ContributionTotal, 2, 5);
+  Out.Append('\n');
+  Out.Flush();
 }
@@ -5,36 +5,89 @@
  * \brief
  */
 /**********************************************************************/
+#ifndef INVESTMENTDATA_H
+#define INVESTMENTDATA_H
 
-class InvestmentData
+#include <vector> //Chunk index
+
+class HistoryArena;
+class OutputBuffer;
+
+/* Totals over a window of rows. Growth is interest plus contributions. */
+struct HistoryRange
 {
-  private:
-    struct YearlyData
-    {
-      double AnnualTotal;
-      double AnnualInterestEarnings;
-      double AnnualContributions;
+  double EndTotal;
+  double Growth;
+  double Interest;
+  double Contributions;
+};
 
-      YearlyData();
-      YearlyData(double Total, double Interest, double Contribution);
-    };
+/* The first InlineRows rows live inside the object, so histories of
+ * typical length never touch the heap; later rows are stored in fixed
+ * size chunks of ChunkRows rows. Inside the inline block and each chunk
+ * every column (structure of arrays) is contiguous and cache line aligned.
+ * Chunks also keep running sums of interest and contributions, which makes
+ * any range summary a pair of subtractions; the inline block keeps only
+ * the three stored columns, to stay small and cheap to move, and its sums
+ * are added up when asked for. Growing adds a chunk to the index and never
+ * moves stored rows. */
+class InvestmentData
+{
+  public:
+    static constexpr int ColumnCount = 5;
+    static constexpr int InlineColumns = 3;
+    static constexpr int ChunkRows = 64;
+    static constexpr int InlineRows = 64;
 
-    YearlyData* Portfolio_;
+  private:
+    alignas(64) double Inline_[InlineColumns * InlineRows];
+    std::vector<double*> Chunks_;
     int CurrentIndex_ = 0;
-    int PortfolioSize_ = 0;
     int StartYear_ = 0; 
+    int YearStep_ = 1;
+    bool ShortLastRow_ = false;
+    int LastRowYear_ = 0;
+    HistoryArena* Arena_ = nullptr;
 
-    void Resize();
+    double* RowStart(int Row, int& Stride);
+    double& Cell(int Column, int Row);
+    double Prefix(int Column, int Row);
+    int Capacity();
+    void AddChunk();
+    void ReleaseChunks();
+    void CopyRows(const InvestmentData& Other);
+    void TakeRows(InvestmentData& Other);
+    void RebuildInterestPrefix();
 
   public:
     InvestmentData();
-    InvestmentData(int StartYear);
+    InvestmentData(int StartYear, int YearStep = 1, HistoryArena* Arena = nullptr);
+    InvestmentData(const InvestmentData& Other);
+    InvestmentData(InvestmentData&& Other) noexcept;
+    InvestmentData& operator=(const InvestmentData& Other);
+    InvestmentData& operator=(InvestmentData&& Other) noexcept;
     ~InvestmentData();
     void Append(double Total, double InterestEarnings, double Contributions);
-    void Get(int StartIndex=0, int EndIndex=0);
+    void Reserve(int Rows);
+    void Truncate(int Rows);
+    void Clear();
+    void AddCompoundedDelta(double Delta, double Rate);
+    void LabelLastRow(int Year);
+    int Size();
+    int StartYear();
+    int YearStep();
+    int YearAt(int Index);
+    double TotalAt(int Index);
+    double InterestAt(int Index);
+    double ContributionAt(int Index);
+    HistoryRange Get(int StartIndex=0, int EndIndex=0);
     void PrintContents();
     void PrintCumulative();
 };
 
 void PrintContentsLabelRow();
+void AppendContentsRow(OutputBuffer& Out, int Year, double Total, double Interest, double Contribution);
 void PrintCumulativeLabelRow();
+void PrintCumulativeRow(double Total, double InterestTotal, double ContributionTotal);
+
+#endif
@@ -0,0 +1,315 @@
+/**********************************************************************/
+/*! \file  MappedHistory.cpp
+ * \author Seth Peterson
+ * \date   2020-10-05
+ * \brief
+ *     Memory-mapped history files. The file is a 64 byte header followed
+ *     by fixed width records, so record i always sits at the same offset
+ *     and readers need no parsing or copying to use it.
+ */
+/**********************************************************************/
+#include "MappedHistory.h"
+#include "InvestmentData.h" //Rows to append
+#include <sys/mman.h> //For mmap, munmap and msync
+#include <sys/stat.h> //For fstat
+#include <fcntl.h> //For open
+#include <unistd.h> //For ftruncate and close
+#include <cerrno> //For errno
+#include <cstring> //For memcpy and memcmp
+#include <stdexcept> //For malformed files and misuse
+#include <system_error> //For failed system calls
+#include <algorithm> //For std::max and std::min
+
+static const char HistoryMagic[8] = {'I', 'C', 'H', 'I', 'S', 'T', '\0', '\0'};
+static const uint32_t HistoryVersion = 1;
+
+struct HistoryFileHeader
+{
+  char Magic[8];
+  uint32_t Version;
+  uint32_t RecordSize;
+  uint64_t Count;
+  uint64_t Reserved[5];
+};
+
+static_assert(sizeof(HistoryFileHeader) == 64, "Records must start on a cache line.");
+static_assert(sizeof(HistoryRecord) == 32, "The file format depends on the record size.");
+
+//Throws the error of the system call that just failed.
+static void ThrowSystemError(const std::string& What)
+{
+  throw std::system_error(errno, std::generic_category(), What);
+}
+
+//Bytes of a file holding Records records.
+static size_t FileBytes(size_t Records)
+{
+  return sizeof(HistoryFileHeader) + Records * sizeof(HistoryRecord);
+}
+
+/*! \brief
+ * Creates (or truncates) the file and maps room for the first records.
+ * \param Path
+ * File to write.
+ * \param InitialRecords
+ * Records to make room for up front; the file doubles when it fills.
+ */
+MappedHistoryWriter::MappedHistoryWriter(const std::string& Path, size_t InitialRecords) :
+  Path_(Path)
+{
+  File_ = open(Path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (File_ < 0)
+  {
+    ThrowSystemError("Could not create history file " + Path);
+  }
+  try
+  {
+    Remap(std::max<size_t>(InitialRecords, 1));
+  }
+  catch (...)
+  {
+    close(File_);
+    File_ = -1;
+    throw;
+  }
+  HistoryFileHeader* Header = reinterpret_cast<HistoryFileHeader*>(Map_);
+  std::memcpy(Header->Magic, HistoryMagic, sizeof(HistoryMagic));
+  Header->Version = HistoryVersion;
+  Header->RecordSize = sizeof(HistoryRecord);
+  Header->Count = 0;
+}
+
+//Destructor trims the file to the records written. Errors are lost here;
+//call Close first to see them.
+MappedHistoryWriter::~MappedHistoryWriter()
+{
+  try
+  {
+    Close();
+  }
+  catch (...)
+  {
+  }
+}
+
+//Resizes the file for Capacity records and maps all of it again.
+void MappedHistoryWriter::Remap(size_t Capacity)
+{
+  size_t Bytes = FileBytes(Capacity);
+  if (ftruncate(File_, static_cast<off_t>(Bytes)) != 0)
+  {
+    ThrowSystemError("Could not grow history file " + Path_);
+  }
+  if (Map_ != nullptr)
+  {
+    munmap(Map_, MapBytes_);
+    Map_ = nullptr;
+    MapBytes_ = 0;
+    Capacity_ = 0;
+  }
+  void* Map = mmap(nullptr, Bytes, PROT_READ | PROT_WRITE, MAP_SHARED, File_, 0);
+  if (Map == MAP_FAILED)
+  {
+    ThrowSystemError("Could not map history file " + Path_);
+  }
+  Map_ = static_cast<char*>(Map);
+  MapBytes_ = Bytes;
+  Capacity_ = Capacity;
+}
+
+/*! \brief
+ * Adds one record at the end of the file.
+ */
+void MappedHistoryWriter::Append(uint32_t Scenario, int32_t Year, double Total, double Interest, double Contribution)
+{
+  if (Count_ == Capacity_)
+  {
+    Reserve(Count_ + 1);
+  }
+  HistoryRecord* Records = reinterpret_cast<HistoryRecord*>(Map_ + sizeof(HistoryFileHeader));
+  Records[Count_] = HistoryRecord{Scenario, Year, Total, Interest, Contribution};
+  ++Count_;
+  Publish();
+}
+
+/*! \brief
+ * Adds every row of a history as records of one scenario.
+ * \param Scenario
+ * Identifier stored with each row.
+ * \param History
+ * Rows to add, labelled with the years PrintContents shows.
+ */
+void MappedHistoryWriter::Append(uint32_t Scenario, InvestmentData& History)
+{
+  int Rows = History.Size();
+  Reserve(Count_ + Rows);
+  HistoryRecord* Records = reinterpret_cast<HistoryRecord*>(Map_ + sizeof(HistoryFileHeader)) + Count_;
+  for (int Row = 0; Row < Rows; ++Row)
+  {
+    Records[Row] = HistoryRecord{Scenario, History.YearAt(Row), History.TotalAt(Row), History.InterestAt(Row), History.ContributionAt(Row)};
+  }
+  Count_ += Rows;
+  Publish();
+}
+
+/*! \brief
+ * Scenario id given to rows that arrive through the sink interface.
+ */
+void MappedHistoryWriter::SetScenario(uint32_t Scenario)
+{
+  Scenario_ = Scenario;
+}
+
+/*! \brief
+ * Adds a projection row as it is computed, so PredictGrowth(Years, Writer)
+ * fills the file without building the history in memory first.
+ */
+void MappedHistoryWriter::Row(const HistoryRow& Row)
+{
+  Append(Scenario_, Row.Year, Row.Total, Row.Interest, Row.Contribution);
+}
+
+//Stores the record count in the header after the records themselves, so
+//a reader that sees the count also sees the records.
+void MappedHistoryWriter::Publish()
+{
+  __atomic_store_n(&reinterpret_cast<HistoryFileHeader*>(Map_)->Count, static_cast<uint64_t>(Count_), __ATOMIC_RELEASE);
+}
+
+/*! \brief
+ * Makes room for at least Records records in total, at least doubling the
+ * file when it has to grow so appends stay amortized O(1).
+ */
+void MappedHistoryWriter::Reserve(size_t Records)
+{
+  if (File_ < 0)
+  {
+    throw std::logic_error("History file " + Path_ + " is already closed.");
+  }
+  if (Records > Capacity_)
+  {
+    Remap(std::max(Records, Capacity_ * 2));
+  }
+}
+
+/*! \brief
+ * Writes the mapped pages back to the file and waits for the writes.
+ */
+void MappedHistoryWriter::Flush()
+{
+  if (Map_ != nullptr && msync(Map_, MapBytes_, MS_SYNC) != 0)
+  {
+    ThrowSystemError("Could not flush history file " + Path_);
+  }
+}
+
+/*! \brief
+ * Unmaps the file and trims the unused capacity off its end. Further
+ * appends throw.
+ */
+void MappedHistoryWriter::Close()
+{
+  if (File_ < 0)
+  {
+    return;
+  }
+  if (Map_ != nullptr)
+  {
+    munmap(Map_, MapBytes_);
+    Map_ = nullptr;
+    MapBytes_ = 0;
+    Capacity_ = 0;
+  }
+  int Result = ftruncate(File_, static_cast<off_t>(FileBytes(Count_)));
+  int Error = errno;
+  close(File_);
+  File_ = -1;
+  if (Result != 0)
+  {
+    errno = Error;
+    ThrowSystemError("Could not trim history file " + Path_);
+  }
+}
+
+//Records written so far.
+size_t MappedHistoryWriter::Count()
+{
+  return Count_;
+}
+
+/*! \brief
+ * Maps a history file read-only and checks its header.
+ * \param Path
+ * File written by MappedHistoryWriter, possibly still being written.
+ */
+MappedHistoryReader::MappedHistoryReader(const std::string& Path)
+{
+  File_ = open(Path.c_str(), O_RDONLY);
+  if (File_ < 0)
+  {
+    ThrowSystemError("Could not open history file " + Path);
+  }
+  struct stat Status;
+  if (fstat(File_, &Status) != 0)
+  {
+    int Error = errno;
+    close(File_);
+    errno = Error;
+    ThrowSystemError("Could not read history file " + Path);
+  }
+  size_t Bytes = static_cast<size_t>(Status.st_size);
+  if (Bytes < sizeof(HistoryFileHeader))
+  {
+    close(File_);
+    throw std::invalid_argument(Path + " is not a history file.");
+  }
+  void* Map = mmap(nullptr, Bytes, PROT_READ, MAP_SHARED, File_, 0);
+  if (Map == MAP_FAILED)
+  {
+    int Error = errno;
+    close(File_);
+    errno = Error;
+    ThrowSystemError("Could not map history file " + Path);
+  }
+  Map_ = static_cast<const char*>(Map);
+  MapBytes_ = Bytes;
+
+  const HistoryFileHeader* Header = reinterpret_cast<const HistoryFileHeader*>(Map_);
+  if (std::memcmp(Header->Magic, HistoryMagic, sizeof(HistoryMagic)) != 0 ||
+      Header->Version != HistoryVersion || Header->RecordSize != sizeof(HistoryRecord))
+  {
+    munmap(const_cast<char*>(Map_), MapBytes_);
+    close(File_);
+    throw std::invalid_argument(Path + " is not a history file this version can read.");
+  }
+  //Only trust records that are both counted and inside the mapping.
+  uint64_t Published = __atomic_load_n(&Header->Count, __ATOMIC_ACQUIRE);
+  Count_ = std::min<size_t>(Published, (Bytes - sizeof(HistoryFileHeader)) / sizeof(HistoryRecord));
+}
+
+MappedHistoryReader::~MappedHistoryReader()
+{
+  munmap(const_cast<char*>(Map_), MapBytes_);
+  close(File_);
+}
+
+//First record; the rest follow contiguously.
+const HistoryRecord* MappedHistoryReader::Records()
+{
+  return reinterpret_cast<const HistoryRecord*>(Map_ + sizeof(HistoryFileHeader));
+}
+
+const HistoryRecord& MappedHistoryReader::operator[](size_t Index)
+{
+  if (Index >= Count_)
+  {
+    throw std::out_of_range("History record index past the end of the file.");
+  }
+  return Records()[Index];
+}
+
+//Records that were in the file when it was opened.
+size_t MappedHistoryReader::Count()
+{
+  return Count_;
+}
@@ -0,0 +1,91 @@
+/**********************************************************************/
+/*! \file  MappedHistory.h
+ * \author Seth Peterson
+ * \date   2020-10-05
+ * \brief
+ *     History store backed by a memory-mapped file, for runs whose full
+ *     per-year histories do not fit in memory. One process writes the
+ *     file; any number of readers map it read-only and use the records in
+ *     place.
+ */
+/**********************************************************************/
+#ifndef MAPPEDHISTORY_H
+#define MAPPEDHISTORY_H
+
+#include "HistorySink.h" //Projections can write straight into the file
+#include <cstddef> //For size_t
+#include <cstdint> //Fixed width fields of the file format
+#include <string> //File paths
+
+class InvestmentData;
+
+/* One year of one scenario, exactly as it is laid out in the file. */
+struct HistoryRecord
+{
+  uint32_t Scenario;
+  int32_t Year;
+  double Total;
+  double Interest;
+  double Contribution;
+};
+
+/* Appends records to a file, growing it with ftruncate and remapping. The
+ * record count in the file header is kept current and published with a
+ * release store after the records it covers, so a reader opened while
+ * writing sees every record appended before it mapped the file. As a
+ * HistorySink it is the backing store of a projection: rows go straight
+ * from PredictGrowth into the mapping, with no in-memory history. */
+class MappedHistoryWriter : public HistorySink
+{
+  private:
+    std::string Path_;
+    int File_ = -1;
+    char* Map_ = nullptr;
+    size_t MapBytes_ = 0;
+    size_t Capacity_ = 0;
+    size_t Count_ = 0;
+    uint32_t Scenario_ = 0;
+
+    void Remap(size_t Capacity);
+    void Publish();
+
+  public:
+    MappedHistoryWriter(const std::string& Path, size_t InitialRecords = 1 << 16);
+    ~MappedHistoryWriter();
+
+    MappedHistoryWriter(const MappedHistoryWriter&) = delete;
+    MappedHistoryWriter& operator=(const MappedHistoryWriter&) = delete;
+
+    void Append(uint32_t Scenario, int32_t Year, double Total, double Interest, double Contribution);
+    void Append(uint32_t Scenario, InvestmentData& History);
+    void SetScenario(uint32_t Scenario);
+    void Row(const HistoryRow& Row) override;
+    void Reserve(size_t Records);
+    void Flush();
+    void Close();
+    size_t Count();
+};
+
+/* Read-only view of a file from MappedHistoryWriter. Records are read
+ * straight from the mapping and are valid for the reader's lifetime. */
+class MappedHistoryReader
+{
+  private:
+    int File_ = -1;
+    const char* Map_ = nullptr;
+    size_t MapBytes_ = 0;
+    size_t Count_ = 0;
+
+  public:
+    MappedHistoryReader(const std::string& Path);
+    ~MappedHistoryReader();
+
+    MappedHistoryReader(const MappedHistoryReader&) = delete;
+    MappedHistoryReader& operator=(const MappedHistoryReader&) = delete;
+
+    const HistoryRecord* Records();
+    const HistoryRecord& operator[](size_t Index);
+    size_t Count();
+};
+
+#endif
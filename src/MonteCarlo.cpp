@@ -0,0 +1,136 @@
+/**********************************************************************/
+/*! \file  MonteCarlo.cpp
+ * \author Seth Peterson
+ * \date   2020-09-24
+ * \brief
+ *     Stochastic projections. Paths are cut into fixed chunks, and every
+ *     chunk owns a random stream seeded from (Seed, chunk). Chunks are
+ *     grouped into a fixed number of tasks that depends only on Paths;
+ *     each task runs its chunks in order into its own statistics, and the
+ *     tasks are merged in task order at the end. Which worker runs a task
+ *     never matters, so a run is reproducible bit for bit no matter how
+ *     many threads share the work.
+ */
+/**********************************************************************/
+#include "MonteCarlo.h"
+#include "InvestmentCalculator.h" //For CalculateNextTotal
+#include "ThreadPool.h"
+#include <cmath> //For log and sqrt
+#include <random> //For the per-chunk generators
+#include <stdexcept> //For bad distribution parameters
+#include <vector> //Per-task accumulators
+
+//Paths drawn from one random stream.
+static const unsigned long long PathsPerChunk = 4096;
+//Upper bound on tasks, which bounds the sketches alive at once while
+//leaving enough tasks for work stealing to balance.
+static const unsigned long long MaxTasks = 128;
+
+//Keeps each task's accumulators on their own cache lines.
+struct alignas(64) TaskStatistics
+{
+  RunningStatistics Stats;
+  TDigest Sketch;
+};
+
+/*! \brief
+ * Simulates many paths of an investment with random yearly returns.
+ * \param InitialCapital
+ * Investment held in year 0.
+ * \param YearlyContribution
+ * Flat amount added at the end of every year.
+ * \param Years
+ * Length of every path.
+ * \param Returns
+ * Distribution of the yearly growth multiplier. For LogNormal the mean and
+ * volatility describe the multiplier itself, not its logarithm. Normal
+ * draws below zero are clamped to zero, an account cannot lose more than
+ * everything.
+ * \param Paths
+ * Number of paths to simulate.
+ * \param Seed
+ * Base seed; the same seed always produces the same result.
+ * \param Pool
+ * Workers to spread the paths over.
+ * \return
+ * Statistics and P5/P25/P50/P75/P95 of the final balance over all paths.
+ * \throws std::invalid_argument
+ * If the volatility is negative or either parameter is not finite, or if
+ * a LogNormal mean is not positive.
+ */
+MonteCarloResult RunMonteCarlo(double InitialCapital, double YearlyContribution, unsigned Years, const ReturnDistribution& Returns, unsigned long long Paths, unsigned long long Seed, ThreadPool& Pool)
+{
+  if (!std::isfinite(Returns.Mean) || !std::isfinite(Returns.Volatility) || Returns.Volatility < 0.0)
+  {
+    throw std::invalid_argument("Return distribution needs a finite mean and a finite, non-negative volatility.");
+  }
+  if (Returns.Kind == ReturnDistribution::LogNormal && Returns.Mean <= 0.0)
+  {
+    throw std::invalid_argument("LogNormal return distribution needs a positive mean multiplier.");
+  }
+
+  double Location = Returns.Mean;
+  double Scale = Returns.Volatility;
+  if (Returns.Kind == ReturnDistribution::LogNormal)
+  {
+    //Match the multiplier's mean and standard deviation in log space.
+    double Variance = std::log1p((Returns.Volatility * Returns.Volatility) / (Returns.Mean * Returns.Mean));
+    Location = std::log(Returns.Mean) - 0.5 * Variance;
+    Scale = std::sqrt(Variance);
+  }
+
+  unsigned long long Chunks = (Paths + PathsPerChunk - 1) / PathsPerChunk;
+  unsigned long long ChunksPerTask = (Chunks + MaxTasks - 1) / MaxTasks;
+  unsigned long long Tasks = (ChunksPerTask == 0) ? 0 : (Chunks + ChunksPerTask - 1) / ChunksPerTask;
+  std::vector<TaskStatistics> PerTask(Tasks);
+
+  Pool.Run(static_cast<unsigned>(Tasks), [&](unsigned Task, unsigned)
+  {
+    unsigned long long FirstChunk = Task * ChunksPerTask;
+    unsigned long long LastChunk = (FirstChunk + ChunksPerTask < Chunks) ? FirstChunk + ChunksPerTask : Chunks;
+    for (unsigned long long Chunk = FirstChunk; Chunk < LastChunk; ++Chunk)
+    {
+      std::seed_seq Sequence{static_cast<unsigned>(Seed), static_cast<unsigned>(Seed >> 32), static_cast<unsigned>(Chunk)};
+      std::mt19937_64 Generator(Sequence);
+      std::normal_distribution<double> Draw(Location, Scale);
+
+      unsigned long long Begin = Chunk * PathsPerChunk;
+      unsigned long long End = (Begin + PathsPerChunk < Paths) ? Begin + PathsPerChunk : Paths;
+
+      RunningStatistics Local;
+      for (unsigned long long Path = Begin; Path < End; ++Path)
+      {
+        double Capital = InitialCapital;
+        for (unsigned Year = 0; Year < Years; ++Year)
+        {
+          double Rate = Draw(Generator);
+          if (Returns.Kind == ReturnDistribution::LogNormal)
+          {
+            Rate = std::exp(Rate);
+          }
+          else if (Rate < 0.0)
+          {
+            Rate = 0.0;
+          }
+          Capital = CalculateNextTotal(Capital, Rate, YearlyContribution);
+        }
+        Local.Add(Capital);
+        PerTask[Task].Sketch.Add(Capital);
+      }
+      PerTask[Task].Stats.Merge(Local);
+    }
+  });
+
+  MonteCarloResult Result;
+  for (const TaskStatistics& Task : PerTask)
+  {
+    Result.FinalBalance.Merge(Task.Stats);
+    Result.FinalBalanceSketch.Merge(Task.Sketch);
+  }
+  Result.P5 = Result.FinalBalanceSketch.Quantile(0.05);
+  Result.P25 = Result.FinalBalanceSketch.Quantile(0.25);
+  Result.P50 = Result.FinalBalanceSketch.Quantile(0.50);
+  Result.P75 = Result.FinalBalanceSketch.Quantile(0.75);
+  Result.P95 = Result.FinalBalanceSketch.Quantile(0.95);
+  return Result;
+}
@@ -0,0 +1,47 @@
+/**********************************************************************/
+/*! \file  MonteCarlo.h
+ * \author Seth Peterson
+ * \date   2020-09-24
+ * \brief
+ *     Stochastic projections where every year's rate is drawn from a
+ *     distribution instead of being a fixed multiplier.
+ */
+/**********************************************************************/
+#ifndef MONTECARLO_H
+#define MONTECARLO_H
+
+#include "RunningStatistics.h" //Final balance statistics
+#include "QuantileSketch.h" //Final balance percentiles
+
+class ThreadPool;
+
+/* Distribution of the yearly growth multiplier (1.07 means +7%). */
+struct ReturnDistribution
+{
+  enum Shape
+  {
+    Normal,
+    LogNormal
+  };
+
+  Shape Kind;
+  double Mean;
+  double Volatility;
+};
+
+/* Summary of the final balances across all simulated paths. Percentiles
+ * come from merged per-task sketches, no path is ever stored. */
+struct MonteCarloResult
+{
+  RunningStatistics FinalBalance;
+  TDigest FinalBalanceSketch;
+  double P5;
+  double P25;
+  double P50;
+  double P75;
+  double P95;
+};
+
+MonteCarloResult RunMonteCarlo(double InitialCapital, double YearlyContribution, unsigned Years, const ReturnDistribution& Returns, unsigned long long Paths, unsigned long long Seed, ThreadPool& Pool);
+
+#endif
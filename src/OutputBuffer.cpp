@@ -0,0 +1,212 @@
+/**********************************************************************/
+/*! \file  OutputBuffer.cpp
+ * \author Seth Peterson
+ * \date   2020-10-16
+ * \brief
+ *     Buffered to_chars output. AppendFixed(Value, 2, 5) writes exactly
+ *     what printf("%5.2f") writes, without parsing a format string,
+ *     consulting the locale or locking the stream for every number.
+ */
+/**********************************************************************/
+#include "OutputBuffer.h"
+#include "AsyncWriter.h" //For handing buffers to the writer thread
+#include <unistd.h> //For write
+#include <cerrno> //For errno
+#include <charconv> //For to_chars
+#include <cstring> //For memcpy, memmove and memset
+#include <system_error> //For failed writes
+
+//Longest fixed notation double: sign, 309 integer digits and a point.
+static const size_t FixedDigits = 311;
+static const size_t IntegerDigits = 21;
+//Longest shortest-round-trip double, e.g. -2.2250738585072014e-308.
+static const size_t ShortestDigits = 24;
+
+/*! \brief
+ * \param Stream
+ * Stream whose file descriptor the text is written to.
+ * \param Capacity
+ * Bytes collected before a write happens on its own.
+ */
+OutputBuffer::OutputBuffer(FILE* Stream, size_t Capacity) :
+  Buffer_(Capacity), Stream_(Stream), Descriptor_(fileno(Stream))
+{
+}
+
+//Destructor writes whatever is left. Errors are lost here; call Flush
+//first to see them.
+OutputBuffer::~OutputBuffer()
+{
+  try
+  {
+    Flush();
+  }
+  catch (...)
+  {
+  }
+}
+
+//Room for Bytes more characters, writing out what is collected if needed.
+char* OutputBuffer::Reserve(size_t Bytes)
+{
+  if (Used_ + Bytes > Buffer_.size())
+  {
+    Flush();
+    if (Bytes > Buffer_.size())
+    {
+      Buffer_.resize(Bytes);
+    }
+  }
+  return Buffer_.data() + Used_;
+}
+
+//Right aligns Length characters at Start in a field of Width, like printf.
+void OutputBuffer::Pad(char* Start, size_t Length, int Width)
+{
+  size_t Field = (Width > 0) ? static_cast<size_t>(Width) : 0;
+  if (Length < Field)
+  {
+    std::memmove(Start + (Field - Length), Start, Length);
+    std::memset(Start, ' ', Field - Length);
+    Length = Field;
+  }
+  Used_ += Length;
+}
+
+void OutputBuffer::Append(const char* Text, size_t Length)
+{
+  std::memcpy(Reserve(Length), Text, Length);
+  Used_ += Length;
+}
+
+void OutputBuffer::Append(const char* Text)
+{
+  Append(Text, std::strlen(Text));
+}
+
+void OutputBuffer::Append(char Character)
+{
+  *Reserve(1) = Character;
+  ++Used_;
+}
+
+/*! \brief
+ * Same text as printf("%*lld", Width, Value).
+ */
+void OutputBuffer::AppendInteger(long long Value, int Width)
+{
+  char* Start = Reserve(IntegerDigits + ((Width > 0) ? Width : 0));
+  char* End = std::to_chars(Start, Start + IntegerDigits, Value).ptr;
+  Pad(Start, End - Start, Width);
+}
+
+/*! \brief
+ * Same text as printf("%*.*f", Width, Precision, Value).
+ */
+void OutputBuffer::AppendFixed(double Value, int Precision, int Width)
+{
+  size_t Room = FixedDigits + Precision;
+  char* Start = Reserve(Room + ((Width > 0) ? Width : 0));
+  char* End = std::to_chars(Start, Start + Room, Value, std::chars_format::fixed, Precision).ptr;
+  Pad(Start, End - Start, Width);
+}
+
+/*! \brief
+ * Shortest text that reads back as exactly the same double, for machine
+ * readable output.
+ */
+void OutputBuffer::AppendShortest(double Value)
+{
+  char* Start = Reserve(ShortestDigits);
+  Used_ += std::to_chars(Start, Start + ShortestDigits, Value).ptr - Start;
+}
+
+/*! \brief
+ * Writes everything collected so far, after anything already sitting in
+ * the stream's stdio buffer, or queues it on the attached AsyncWriter.
+ */
+void OutputBuffer::Flush()
+{
+  if (Used_ == 0)
+  {
+    return;
+  }
+  size_t Used = Used_;
+  Used_ = 0;
+  if (Async_ != nullptr)
+  {
+    Async_->Submit(Descriptor_, Buffer_, Used);
+    return;
+  }
+  fflush(Stream_);
+  int Error = WriteAll(Descriptor_, Buffer_.data(), Used);
+  if (Error != 0)
+  {
+    throw std::system_error(Error, std::generic_category(), "Could not write output");
+  }
+}
+
+//Characters collected and not yet written.
+size_t OutputBuffer::Size()
+{
+  return Used_;
+}
+
+/*! \brief
+ * Sends later flushes through Writer's thread, or back to direct writes
+ * when Writer is null. What was collected before is written out first,
+ * so the stream's order is kept. Detach before the writer is destroyed.
+ */
+void OutputBuffer::SetAsyncWriter(AsyncWriter* Writer)
+{
+  //The old writer is let go first, so a failed write it reports cannot
+  //leave this buffer pointing at it.
+  AsyncWriter* Previous = Async_;
+  Async_ = nullptr;
+  if (Previous != nullptr)
+  {
+    if (Used_ > 0)
+    {
+      size_t Used = Used_;
+      Used_ = 0;
+      Previous->Submit(Descriptor_, Buffer_, Used);
+    }
+    Previous->Wait();
+  }
+  Flush();
+  fflush(Stream_);
+  Async_ = Writer;
+}
+
+/*! \brief
+ * Writes all Length bytes, retrying short and interrupted writes.
+ * \return
+ * Zero, or the errno of the write that failed.
+ */
+int WriteAll(int Descriptor, const char* Text, size_t Length)
+{
+  size_t Written = 0;
+  while (Written < Length)
+  {
+    ssize_t Result = write(Descriptor, Text + Written, Length - Written);
+    if (Result < 0)
+    {
+      if (errno == EINTR)
+      {
+        continue;
+      }
+      return errno;
+    }
+    Written += static_cast<size_t>(Result);
+  }
+  return 0;
+}
+
+/*! \brief
+ * Buffer for stdout, one per thread, reused by every print function.
+ */
+OutputBuffer& StandardOutput()
+{
+  static thread_local OutputBuffer Out(stdout);
+  return Out;
+}
@@ -0,0 +1,59 @@
+/**********************************************************************/
+/*! \file  OutputBuffer.h
+ * \author Seth Peterson
+ * \date   2020-10-16
+ * \brief
+ *     Text output without printf. Numbers are rendered with to_chars
+ *     straight into a large reusable buffer, which goes out in single
+ *     write calls.
+ */
+/**********************************************************************/
+#ifndef OUTPUTBUFFER_H
+#define OUTPUTBUFFER_H
+
+#include <cstddef> //For size_t
+#include <cstdio> //For FILE
+#include <vector> //Buffer storage
+
+class AsyncWriter;
+
+/* Collects text for one stream. Flush first flushes the stream's own
+ * stdio buffer, so output stays in order when printf and an OutputBuffer
+ * share a stream, as long as the OutputBuffer is flushed before printf is
+ * used again. While an AsyncWriter is attached, Flush hands the buffer to
+ * the writer thread and returns at once; printf output then has no order
+ * relative to this buffer until the writer is detached. */
+class OutputBuffer
+{
+  private:
+    std::vector<char> Buffer_;
+    size_t Used_ = 0;
+    FILE* Stream_;
+    int Descriptor_;
+    AsyncWriter* Async_ = nullptr;
+
+    char* Reserve(size_t Bytes);
+    void Pad(char* Start, size_t Length, int Width);
+
+  public:
+    OutputBuffer(FILE* Stream = stdout, size_t Capacity = 1 << 16);
+    ~OutputBuffer();
+
+    OutputBuffer(const OutputBuffer&) = delete;
+    OutputBuffer& operator=(const OutputBuffer&) = delete;
+
+    void Append(const char* Text, size_t Length);
+    void Append(const char* Text);
+    void Append(char Character);
+    void AppendInteger(long long Value, int Width = 0);
+    void AppendFixed(double Value, int Precision, int Width = 0);
+    void AppendShortest(double Value);
+    void Flush();
+    size_t Size();
+    void SetAsyncWriter(AsyncWriter* Writer);
+};
+
+int WriteAll(int Descriptor, const char* Text, size_t Length);
+OutputBuffer& StandardOutput();
+
+#endif
@@ -0,0 +1,205 @@
+/**********************************************************************/
+/*! \file  ParameterSweep.cpp
+ * \author Seth Peterson
+ * \date   2020-09-28
+ * \brief
+ *     Cartesian product sweep over the calculator's parameters. The
+ *     output matrix is cut into fixed size blocks of cells, each one task
+ *     on the work stealing pool, so every shape of grid spreads over all
+ *     workers; every cell uses the closed form so its cost does not depend
+ *     on the horizon.
+ */
+/**********************************************************************/
+#include "ParameterSweep.h"
+#include "InvestmentCalculator.h" //For CalculateClosedFormTotal
+#include "ThreadPool.h"
+#include "OutputBuffer.h" //For printing rows
+#include "HistorySink.h" //For JsonBufferOutput
+#include <algorithm> //For std::min
+
+/*! \brief
+ * Value at a position in the range.
+ */
+double SweepRange::At(unsigned Index) const
+{
+  return Start + Step * static_cast<double>(Index);
+}
+
+/*! \brief
+ * Number of cells in the full Cartesian product.
+ */
+size_t SweepGrid::Cells() const
+{
+  return static_cast<size_t>(Capital.Count) * Rate.Count * Contribution.Count * Years.Count;
+}
+
+/*! \brief
+ * Position of a cell in the output matrix. Years vary fastest, then
+ * contribution, then rate, then capital.
+ */
+size_t SweepGrid::Index(unsigned CapitalIndex, unsigned RateIndex, unsigned ContributionIndex, unsigned YearsIndex) const
+{
+  return ((static_cast<size_t>(CapitalIndex) * Rate.Count + RateIndex) * Contribution.Count + ContributionIndex) * Years.Count + YearsIndex;
+}
+
+//Cells per pool task. Enough closed forms to dwarf handing out the task,
+//few enough that small sweeps still reach every worker.
+static const size_t SweepBlockCells = 256;
+
+//Years a sweep value stands for; sweeps only project whole years.
+static unsigned WholeYears(double Years)
+{
+  return (Years > 0) ? static_cast<unsigned>(Years + 0.5) : 0;
+}
+
+/*! \brief
+ * Fills a preallocated matrix with the final total of every cell.
+ * \param Grid
+ * Ranges to sweep.
+ * \param FinalTotals
+ * Output matrix of Grid.Cells() values, laid out as SweepGrid::Index.
+ * \param Pool
+ * Workers that share the blocks of cells.
+ */
+void RunSweep(const SweepGrid& Grid, double* FinalTotals, ThreadPool& Pool)
+{
+  size_t Cells = Grid.Cells();
+  unsigned Blocks = static_cast<unsigned>((Cells + SweepBlockCells - 1) / SweepBlockCells);
+  Pool.Run(Blocks, [&](unsigned Task, unsigned)
+  {
+    size_t First = static_cast<size_t>(Task) * SweepBlockCells;
+    size_t Last = std::min(First + SweepBlockCells, Cells);
+
+    //Position of the first cell, in SweepGrid::Index order; later cells
+    //are reached by counting up with carries.
+    unsigned y = static_cast<unsigned>(First % Grid.Years.Count);
+    size_t Rest = First / Grid.Years.Count;
+    unsigned c = static_cast<unsigned>(Rest % Grid.Contribution.Count);
+    Rest /= Grid.Contribution.Count;
+    unsigned r = static_cast<unsigned>(Rest % Grid.Rate.Count);
+    unsigned a = static_cast<unsigned>(Rest / Grid.Rate.Count);
+
+    for (size_t Cell = First; Cell < Last; ++Cell)
+    {
+      FinalTotals[Cell] = CalculateClosedFormTotal(Grid.Capital.At(a), Grid.Rate.At(r), Grid.Contribution.At(c), WholeYears(Grid.Years.At(y))).FinalTotal;
+      if (++y == Grid.Years.Count)
+      {
+        y = 0;
+        if (++c == Grid.Contribution.Count)
+        {
+          c = 0;
+          if (++r == Grid.Rate.Count)
+          {
+            r = 0;
+            ++a;
+          }
+        }
+      }
+    }
+  });
+}
+
+/*! \brief
+ * Prints a finished sweep as CSV, one row per cell in Index order, with
+ * the cell's index as its scenario id. The rate column is the growth
+ * multiplier the cell used (1.07 for +7%), as the sweep file gives it.
+ */
+void PrintSweepCsv(const SweepGrid& Grid, const double* FinalTotals)
+{
+  OutputBuffer& Out = StandardOutput();
+  Out.Append("scenario_id,capital,rate,contribution,years,total\n");
+  for (unsigned a = 0; a < Grid.Capital.Count; ++a)
+  {
+    for (unsigned r = 0; r < Grid.Rate.Count; ++r)
+    {
+      for (unsigned c = 0; c < Grid.Contribution.Count; ++c)
+      {
+        for (unsigned y = 0; y < Grid.Years.Count; ++y)
+        {
+          size_t Cell = Grid.Index(a,r,c,y);
+          Out.AppendInteger(static_cast<long long>(Cell));
+          Out.Append(',');
+          Out.AppendShortest(Grid.Capital.At(a));
+          Out.Append(',');
+          Out.AppendShortest(Grid.Rate.At(r));
+          Out.Append(',');
+          Out.AppendShortest(Grid.Contribution.At(c));
+          Out.Append(',');
+          Out.AppendInteger(WholeYears(Grid.Years.At(y)));
+          Out.Append(',');
+          Out.AppendShortest(FinalTotals[Cell]);
+          Out.Append('\n');
+        }
+      }
+    }
+  }
+  Out.Flush();
+}
+
+/*! \brief
+ * Prints a finished sweep as one JSON array holding an object per cell,
+ * with PrintSweepCsv's fields, streamed without building a Json::Value.
+ */
+void PrintSweepJson(const SweepGrid& Grid, const double* FinalTotals)
+{
+  OutputBuffer& Out = StandardOutput();
+  JsonBufferOutput Output(Out);
+  Json::Emitter Json(Output);
+  Json.beginArray();
+  for (unsigned a = 0; a < Grid.Capital.Count; ++a)
+  {
+    for (unsigned r = 0; r < Grid.Rate.Count; ++r)
+    {
+      for (unsigned c = 0; c < Grid.Contribution.Count; ++c)
+      {
+        for (unsigned y = 0; y < Grid.Years.Count; ++y)
+        {
+          size_t Cell = Grid.Index(a,r,c,y);
+          Json.beginObject();
+          Json.key("scenario_id").unsignedInteger(Cell);
+          Json.key("capital").number(Grid.Capital.At(a));
+          Json.key("rate").number(Grid.Rate.At(r));
+          Json.key("contribution").number(Grid.Contribution.At(c));
+          Json.key("years").integer(WholeYears(Grid.Years.At(y)));
+          Json.key("total").number(FinalTotals[Cell]);
+          Json.endObject();
+        }
+      }
+    }
+  }
+  Json.endArray();
+  Out.Append('\n');
+  Out.Flush();
+}
+
+/*! \brief
+ * Prints one row per cell of a finished sweep.
+ */
+void PrintSweep(const SweepGrid& Grid, const double* FinalTotals)
+{
+  OutputBuffer& Out = StandardOutput();
+  Out.Append("  Capital  || Interest || Contribution || Years || Total\n");
+  for (unsigned a = 0; a < Grid.Capital.Count; ++a)
+  {
+    for (unsigned r = 0; r < Grid.Rate.Count; ++r)
+    {
+      for (unsigned c = 0; c < Grid.Contribution.Count; ++c)
+      {
+        for (unsigned y = 0; y < Grid.Years.Count; ++y)
+        {
+          Out.AppendFixed(Grid.Capital.At(a), 2, 5);
+          Out.Append(" || ", 4);
+          Out.AppendFixed(Grid.Rate.At(r) - 1.0, 5, 3);
+          Out.Append(" || ", 4);
+          Out.AppendFixed(Grid.Contribution.At(c), 2, 5);
+          Out.Append(" || ", 4);
+          Out.AppendInteger(WholeYears(Grid.Years.At(y)), 5);
+          Out.Append(" || ", 4);
+          Out.AppendFixed(FinalTotals[Grid.Index(a,r,c,y)], 2, 5);
+          Out.Append('\n');
+        }
+      }
+    }
+  }
+  Out.Flush();
+}
@@ -0,0 +1,44 @@
+/**********************************************************************/
+/*! \file  ParameterSweep.h
+ * \author Seth Peterson
+ * \date   2020-09-28
+ * \brief
+ *     Evaluates every combination of capital, rate, contribution and
+ *     horizon in one process, for sensitivity tables.
+ */
+/**********************************************************************/
+#ifndef PARAMETERSWEEP_H
+#define PARAMETERSWEEP_H
+
+#include <cstddef> //For size_t
+
+class ThreadPool;
+
+/* Evenly spaced values Start, Start+Step, ... (Count of them). */
+struct SweepRange
+{
+  double Start;
+  double Step;
+  unsigned Count;
+
+  double At(unsigned Index) const;
+};
+
+/* One range per InvestmentCalculator parameter. Years are rounded. */
+struct SweepGrid
+{
+  SweepRange Capital;
+  SweepRange Rate;
+  SweepRange Contribution;
+  SweepRange Years;
+
+  size_t Cells() const;
+  size_t Index(unsigned CapitalIndex, unsigned RateIndex, unsigned ContributionIndex, unsigned YearsIndex) const;
+};
+
+void RunSweep(const SweepGrid& Grid, double* FinalTotals, ThreadPool& Pool);
+void PrintSweepCsv(const SweepGrid& Grid, const double* FinalTotals);
+void PrintSweepJson(const SweepGrid& Grid, const double* FinalTotals);
+void PrintSweep(const SweepGrid& Grid, const double* FinalTotals);
+
+#endif
@@ -0,0 +1,93 @@
+/**********************************************************************/
+/*! \file  ProjectionRange.cpp
+ * \author Seth Peterson
+ * \date   2020-10-14
+ * \brief
+ *     Lazy projection iterators.
+ */
+/**********************************************************************/
+#include "ProjectionRange.h"
+#include "InvestmentCalculator.h" //Recurrence being walked
+
+/*! \brief
+ * Iterator positioned at Year, with that year's row already computed.
+ * \param Year
+ * First year to yield; Years makes an end iterator.
+ * \param Years
+ * One past the last year of the range.
+ */
+ProjectionIterator::ProjectionIterator(InvestmentCalculator& Calculator, unsigned Year, unsigned Years) :
+  Calculator_(&Calculator), Year_(Year), Years_(Years), Capital_(Calculator.InitialCapital_)
+{
+  if (Year_ < Years_)
+  {
+    Compute();
+  }
+}
+
+//Runs one year of the recurrence from Capital_, exactly as ProjectYears does.
+void ProjectionIterator::Compute()
+{
+  InvestmentCalculator& Calculator = *Calculator_;
+  double Contribution = Calculator.ContributionForYear(Year_);
+  double Total = CalculateNextTotal(Capital_, Calculator.AnnualFactor(Calculator.InterestRate_), Calculator.AnnualAddend(Calculator.InterestRate_, Contribution));
+  Row_ = HistoryRow{static_cast<int>(Year_), Total, Total - Capital_ - Contribution, Contribution};
+}
+
+ProjectionIterator::reference ProjectionIterator::operator*() const
+{
+  return Row_;
+}
+
+ProjectionIterator::pointer ProjectionIterator::operator->() const
+{
+  return &Row_;
+}
+
+//Moves to the next year, computing it only if the range goes that far.
+ProjectionIterator& ProjectionIterator::operator++()
+{
+  Capital_ = Row_.Total;
+  if (++Year_ < Years_)
+  {
+    Compute();
+  }
+  return *this;
+}
+
+ProjectionIterator ProjectionIterator::operator++(int)
+{
+  ProjectionIterator Previous = *this;
+  ++*this;
+  return Previous;
+}
+
+bool ProjectionIterator::operator==(const ProjectionIterator& Other) const
+{
+  return Year_ == Other.Year_;
+}
+
+bool ProjectionIterator::operator!=(const ProjectionIterator& Other) const
+{
+  return Year_ != Other.Year_;
+}
+
+/*! \brief
+ * \param Years
+ * Length of the range. The default is effectively endless, for loops that
+ * stop on a condition instead.
+ */
+ProjectionRange::ProjectionRange(InvestmentCalculator& Calculator, unsigned Years) :
+  Calculator_(&Calculator), Years_(Years)
+{
+}
+
+ProjectionIterator ProjectionRange::begin() const
+{
+  return ProjectionIterator(*Calculator_, 0, Years_);
+}
+
+ProjectionIterator ProjectionRange::end() const
+{
+  return ProjectionIterator(*Calculator_, Years_, Years_);
+}
@@ -0,0 +1,73 @@
+/**********************************************************************/
+/*! \file  ProjectionRange.h
+ * \author Seth Peterson
+ * \date   2020-10-14
+ * \brief
+ *     Lazy view of a projection, one year at a time. Nothing is stored:
+ *     each increment runs one step of PredictGrowth's recurrence, so a
+ *     loop that stops at year 7 only ever computes 7 years.
+ *
+ *       for (const HistoryRow& Row : ProjectionRange(Calculator, 50))
+ *       {
+ *         if (Row.Total >= Target) { ... break; }
+ *       }
+ */
+/**********************************************************************/
+#ifndef PROJECTIONRANGE_H
+#define PROJECTIONRANGE_H
+
+#include "HistorySink.h" //For HistoryRow
+#include <cstddef> //For ptrdiff_t
+#include <iterator> //For input_iterator_tag
+#include <limits> //Default horizon
+
+class InvestmentCalculator;
+
+/* Input iterator over the years of a projection. Iterators of one range
+ * compare equal when they are at the same year. */
+class ProjectionIterator
+{
+  private:
+    InvestmentCalculator* Calculator_ = nullptr;
+    unsigned Year_ = 0;
+    unsigned Years_ = 0;
+    double Capital_ = 0.0;
+    HistoryRow Row_ = {0, 0.0, 0.0, 0.0};
+
+    void Compute();
+
+  public:
+    using iterator_category = std::input_iterator_tag;
+    using value_type = HistoryRow;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const HistoryRow*;
+    using reference = const HistoryRow&;
+
+    ProjectionIterator() = default;
+    ProjectionIterator(InvestmentCalculator& Calculator, unsigned Year, unsigned Years);
+
+    reference operator*() const;
+    pointer operator->() const;
+    ProjectionIterator& operator++();
+    ProjectionIterator operator++(int);
+    bool operator==(const ProjectionIterator& Other) const;
+    bool operator!=(const ProjectionIterator& Other) const;
+};
+
+/* Years [0, Years) of a calculator's projection. The calculator must
+ * outlive the range; setters called while iterating apply from the next
+ * year computed. */
+class ProjectionRange
+{
+  private:
+    InvestmentCalculator* Calculator_;
+    unsigned Years_;
+
+  public:
+    ProjectionRange(InvestmentCalculator& Calculator, unsigned Years = std::numeric_limits<unsigned>::max());
+
+    ProjectionIterator begin() const;
+    ProjectionIterator end() const;
+};
+
+#endif
@@ -0,0 +1,191 @@
+/**********************************************************************/
+/*! \file  QuantileSketch.cpp
+ * \author Seth Peterson
+ * \date   2020-09-26
+ * \brief
+ *     Merging t-digest (Dunning & Ertl). Values are collected in a small
+ *     buffer and periodically folded into a sorted list of centroids whose
+ *     sizes are capped by the arcsine scale function, which keeps the tails
+ *     accurate. Memory stays around a few times Compression centroids no
+ *     matter how many values are added.
+ */
+/**********************************************************************/
+#include "QuantileSketch.h"
+#include <algorithm> //For sort, merge, min and max
+#include <iterator> //For back_inserter
+#include <cmath> //For asin and sin
+
+static const double Pi = 3.14159265358979323846;
+
+/*! \brief
+ * Constructs an empty sketch.
+ * \param Compression
+ * Larger values keep more centroids and give tighter estimates.
+ */
+TDigest::TDigest(double Compression) :
+  Compression_(Compression), BufferLimit_(static_cast<size_t>(Compression) * 5)
+{
+  if (BufferLimit_ == 0)
+  {
+    BufferLimit_ = 1;
+  }
+  Buffer_.reserve(BufferLimit_);
+}
+
+/*! \brief
+ * Adds one observation.
+ */
+void TDigest::Add(double Value)
+{
+  Insert(Value, 1.0);
+}
+
+/*! \brief
+ * Folds every centroid of another sketch into this one.
+ */
+void TDigest::Merge(const TDigest& Other)
+{
+  if (Other.Count_ == 0.0)
+  {
+    return;
+  }
+  //Centroid means sit inside the data, so the extremes are taken from the
+  //other sketch rather than from what is inserted below.
+  double Min = (Count_ == 0.0) ? Other.Min_ : std::min(Min_, Other.Min_);
+  double Max = (Count_ == 0.0) ? Other.Max_ : std::max(Max_, Other.Max_);
+  for (const Centroid& c : Other.Centroids_)
+  {
+    Insert(c.Mean, c.Weight);
+  }
+  for (const Centroid& c : Other.Buffer_)
+  {
+    Insert(c.Mean, c.Weight);
+  }
+  Min_ = Min;
+  Max_ = Max;
+}
+
+//Queues a weighted point, compressing when the buffer fills.
+void TDigest::Insert(double Mean, double Weight)
+{
+  if (Count_ == 0.0)
+  {
+    Min_ = Mean;
+    Max_ = Mean;
+  }
+  else
+  {
+    Min_ = (Mean < Min_) ? Mean : Min_;
+    Max_ = (Mean > Max_) ? Mean : Max_;
+  }
+  Count_ += Weight;
+  Buffer_.push_back(Centroid{Mean, Weight});
+  if (Buffer_.size() >= BufferLimit_)
+  {
+    Compress();
+  }
+}
+
+//Merges the buffer into the centroid list in one sorted sweep. The
+//buffer never holds more than BufferLimit_ points and the sorted points go
+//to a separate scratch list, so no list grows with the number of values.
+void TDigest::Compress()
+{
+  if (Buffer_.empty())
+  {
+    return;
+  }
+  auto ByMean = [](const Centroid& a, const Centroid& b) { return a.Mean < b.Mean; };
+  std::sort(Buffer_.begin(), Buffer_.end(), ByMean);
+  Merged_.clear();
+  std::merge(Centroids_.begin(), Centroids_.end(), Buffer_.begin(), Buffer_.end(), std::back_inserter(Merged_), ByMean);
+  Buffer_.clear();
+  Centroids_.clear();
+
+  //Scale function k(q) = delta/(2 pi) * asin(2q - 1); each centroid may span
+  //at most one unit of k.
+  double Scale = Compression_ / (2.0 * Pi);
+  double SoFar = 0.0;
+  Centroid Current = Merged_[0];
+  double Limit = Count_ * (std::sin(std::asin(-1.0) + 1.0 / Scale) + 1.0) / 2.0;
+
+  for (size_t i = 1; i < Merged_.size(); ++i)
+  {
+    const Centroid& Next = Merged_[i];
+    if (SoFar + Current.Weight + Next.Weight <= Limit)
+    {
+      Current.Weight += Next.Weight;
+      Current.Mean += (Next.Mean - Current.Mean) * Next.Weight / Current.Weight;
+    }
+    else
+    {
+      SoFar += Current.Weight;
+      Centroids_.push_back(Current);
+      double k = Scale * std::asin(2.0 * SoFar / Count_ - 1.0) + 1.0;
+      double q = (k >= Scale * Pi / 2.0) ? 1.0 : (std::sin(k / Scale) + 1.0) / 2.0;
+      Limit = Count_ * q;
+      Current = Next;
+    }
+  }
+  Centroids_.push_back(Current);
+}
+
+/*! \brief
+ * Estimates the value below which a fraction of the observations fall.
+ * \param Fraction
+ * Quantile in [0, 1], e.g. 0.95 for P95.
+ * \return
+ * Estimated quantile, or 0 if nothing has been added.
+ */
+double TDigest::Quantile(double Fraction)
+{
+  Compress();
+  if (Centroids_.empty())
+  {
+    return 0.0;
+  }
+  if (Fraction <= 0.0)
+  {
+    return Min_;
+  }
+  if (Fraction >= 1.0)
+  {
+    return Max_;
+  }
+
+  double Target = Fraction * Count_;
+
+  //Before the first centroid's center, interpolate from the minimum.
+  double Center = Centroids_[0].Weight / 2.0;
+  if (Target < Center)
+  {
+    return Min_ + (Centroids_[0].Mean - Min_) * Target / Center;
+  }
+
+  double SoFar = 0.0;
+  for (size_t i = 0; i + 1 < Centroids_.size(); ++i)
+  {
+    double Left = SoFar + Centroids_[i].Weight / 2.0;
+    double Right = SoFar + Centroids_[i].Weight + Centroids_[i + 1].Weight / 2.0;
+    if (Target < Right)
+    {
+      double t = (Target - Left) / (Right - Left);
+      return Centroids_[i].Mean + t * (Centroids_[i + 1].Mean - Centroids_[i].Mean);
+    }
+    SoFar += Centroids_[i].Weight;
+  }
+
+  //Past the last centroid's center, interpolate toward the maximum.
+  const Centroid& Last = Centroids_.back();
+  double Left = Count_ - Last.Weight / 2.0;
+  double t = (Target - Left) / (Count_ - Left);
+  return Last.Mean + t * (Max_ - Last.Mean);
+}
+
+/*! \brief
+ * Total weight of everything added so far.
+ */
+double TDigest::Count() const
+{
+  return Count_;
+}
@@ -0,0 +1,46 @@
+/**********************************************************************/
+/*! \file  QuantileSketch.h
+ * \author Seth Peterson
+ * \date   2020-09-26
+ * \brief
+ *     Bounded memory quantile estimator (merging t-digest). Sketches built
+ *     on different threads can be merged into one.
+ */
+/**********************************************************************/
+#ifndef QUANTILESKETCH_H
+#define QUANTILESKETCH_H
+
+#include <cstddef> //For size_t
+#include <vector> //Centroid storage
+
+class TDigest
+{
+  private:
+    struct Centroid
+    {
+      double Mean;
+      double Weight;
+    };
+
+    double Compression_;
+    size_t BufferLimit_;
+    std::vector<Centroid> Centroids_;
+    std::vector<Centroid> Buffer_;
+    std::vector<Centroid> Merged_;
+    double Count_ = 0.0;
+    double Min_ = 0.0;
+    double Max_ = 0.0;
+
+    void Compress();
+    void Insert(double Mean, double Weight);
+
+  public:
+    TDigest(double Compression = 100.0);
+
+    void Add(double Value);
+    void Merge(const TDigest& Other);
+    double Quantile(double Fraction);
+    double Count() const;
+};
+
+#endif
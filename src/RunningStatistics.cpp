@@ -0,0 +1,87 @@
+/**********************************************************************/
+/*! \file  RunningStatistics.cpp
+ * \author Seth Peterson
+ * \date   2020-09-24
+ * \brief
+ *     Single pass mean/variance/min/max accumulator (Welford).
+ */
+/**********************************************************************/
+#include "RunningStatistics.h"
+#include <cmath> //For sqrt
+
+/*! \brief
+ * Folds one observation into the statistics.
+ */
+void RunningStatistics::Add(double Value)
+{
+  if (Count_ == 0)
+  {
+    Min_ = Value;
+    Max_ = Value;
+  }
+  else
+  {
+    Min_ = (Value < Min_) ? Value : Min_;
+    Max_ = (Value > Max_) ? Value : Max_;
+  }
+  ++Count_;
+  double Delta = Value - Mean_;
+  Mean_ += Delta / static_cast<double>(Count_);
+  SquaredDeviations_ += Delta * (Value - Mean_);
+}
+
+/*! \brief
+ * Combines another accumulator into this one (Chan et al. pairwise update).
+ */
+void RunningStatistics::Merge(const RunningStatistics& Other)
+{
+  if (Other.Count_ == 0)
+  {
+    return;
+  }
+  if (Count_ == 0)
+  {
+    *this = Other;
+    return;
+  }
+  double Total = static_cast<double>(Count_ + Other.Count_);
+  double Delta = Other.Mean_ - Mean_;
+  Mean_ += Delta * static_cast<double>(Other.Count_) / Total;
+  SquaredDeviations_ += Other.SquaredDeviations_ + Delta * Delta * static_cast<double>(Count_) * static_cast<double>(Other.Count_) / Total;
+  Count_ += Other.Count_;
+  Min_ = (Other.Min_ < Min_) ? Other.Min_ : Min_;
+  Max_ = (Other.Max_ > Max_) ? Other.Max_ : Max_;
+}
+
+unsigned long long RunningStatistics::Count() const
+{
+  return Count_;
+}
+
+double RunningStatistics::Mean() const
+{
+  return Mean_;
+}
+
+/*! \brief
+ * Sample variance, zero until there are at least two observations.
+ */
+double RunningStatistics::Variance() const
+{
+  return (Count_ > 1) ? SquaredDeviations_ / static_cast<double>(Count_ - 1) : 0.0;
+}
+
+double RunningStatistics::StdDev() const
+{
+  return std::sqrt(Variance());
+}
+
+double RunningStatistics::Min() const
+{
+  return Min_;
+}
+
+double RunningStatistics::Max() const
+{
+  return Max_;
+}
@@ -0,0 +1,34 @@
+/**********************************************************************/
+/*! \file  RunningStatistics.h
+ * \author Seth Peterson
+ * \date   2020-09-24
+ * \brief
+ *     Single pass mean/variance/min/max accumulator (Welford) that can be
+ *     merged with others, so threads can keep their own and combine later.
+ */
+/**********************************************************************/
+#ifndef RUNNINGSTATISTICS_H
+#define RUNNINGSTATISTICS_H
+
+class RunningStatistics
+{
+  private:
+    unsigned long long Count_ = 0;
+    double Mean_ = 0.0;
+    double SquaredDeviations_ = 0.0;
+    double Min_ = 0.0;
+    double Max_ = 0.0;
+
+  public:
+    void Add(double Value);
+    void Merge(const RunningStatistics& Other);
+
+    unsigned long long Count() const;
+    double Mean() const;
+    double Variance() const;
+    double StdDev() const;
+    double Min() const;
+    double Max() const;
+};
+
+#endif
@@ -0,0 +1,228 @@
+/**********************************************************************/
+/*! \file  ThreadPool.cpp
+ * \author Seth Peterson
+ * \date   2020-09-20
+ * \brief
+ *     A small fixed pool of worker threads used by the parallel
+ *     projection engines. The thread calling Run takes part as worker 0.
+ *     Every job is split into one contiguous range of task indices per
+ *     worker; a worker that runs dry steals the back half of another
+ *     worker's range, so uneven tasks still keep every core busy.
+ */
+/**********************************************************************/
+#include "ThreadPool.h"
+
+/*! \brief
+ * Starts the worker threads.
+ * \param Threads
+ * Total number of workers including the caller of Run. Zero picks one per
+ * hardware thread.
+ */
+ThreadPool::ThreadPool(unsigned Threads)
+{
+  if (Threads == 0)
+  {
+    Threads = std::thread::hardware_concurrency();
+  }
+  if (Threads == 0)
+  {
+    Threads = 1;
+  }
+  Ranges_.reset(new TaskRange[Threads]);
+  for (unsigned i = 1; i < Threads; ++i)
+  {
+    Workers_.emplace_back(&ThreadPool::WorkerLoop, this, i);
+  }
+}
+
+//Destructor tells the workers to leave and joins them.
+ThreadPool::~ThreadPool()
+{
+  {
+    std::lock_guard<std::mutex> guard(Lock_);
+    Stopping_ = true;
+  }
+  WakeUp_.notify_all();
+  for (std::thread& worker : Workers_)
+  {
+    worker.join();
+  }
+}
+
+/*! \brief
+ * Number of workers that share a job, counting the calling thread.
+ */
+unsigned ThreadPool::Size() const
+{
+  return static_cast<unsigned>(Workers_.size()) + 1;
+}
+
+/*! \brief
+ * Runs Work once for every task index and returns when all of them are done.
+ * \param Tasks
+ * Number of task indices to hand out.
+ * \param Work
+ * Called with the task index and the index of the worker running it, so
+ * callers can keep per-worker state without locking.
+ * \throws
+ * The first exception thrown by Work, once every worker has stopped.
+ * Tasks not yet started when it was thrown are skipped.
+ */
+void ThreadPool::Run(unsigned Tasks, const std::function<void(unsigned Task, unsigned Worker)>& Work)
+{
+  if (Tasks == 0)
+  {
+    return;
+  }
+  if (Workers_.empty() || Tasks == 1)
+  {
+    for (unsigned i = 0; i < Tasks; ++i)
+    {
+      Work(i, 0);
+    }
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> guard(Lock_);
+    Job_ = &Work;
+    Failed_ = false;
+    unsigned Share = Tasks / Size();
+    unsigned Extra = Tasks % Size();
+    unsigned Begin = 0;
+    for (unsigned i = 0; i < Size(); ++i)
+    {
+      std::lock_guard<std::mutex> range(Ranges_[i].Lock);
+      Ranges_[i].Next = Begin;
+      Begin += Share + ((i < Extra) ? 1 : 0);
+      Ranges_[i].End = Begin;
+    }
+    Busy_ = static_cast<unsigned>(Workers_.size());
+    ++Generation_;
+  }
+  WakeUp_.notify_all();
+
+  Drain(0);
+
+  std::unique_lock<std::mutex> guard(Lock_);
+  Finished_.wait(guard, [this] { return Busy_ == 0; });
+  Job_ = nullptr;
+  if (Error_)
+  {
+    std::exception_ptr Error = Error_;
+    Error_ = nullptr;
+    std::rethrow_exception(Error);
+  }
+}
+
+//Runs tasks from the worker's own range, stealing once it is empty,
+//until no worker has anything left.
+void ThreadPool::Drain(unsigned Worker)
+{
+  unsigned Task;
+  do
+  {
+    while (TakeTask(Worker, Task))
+    {
+      try
+      {
+        (*Job_)(Task, Worker);
+      }
+      catch (...)
+      {
+        Fail(std::current_exception());
+      }
+    }
+  } while (Steal(Worker));
+}
+
+//Keeps the first exception of the job for Run and empties every range so
+//the other workers stop after their current task. The flag stops workers
+//from taking or stealing anything more.
+void ThreadPool::Fail(std::exception_ptr Error)
+{
+  Failed_ = true;
+  {
+    std::lock_guard<std::mutex> guard(Lock_);
+    if (!Error_)
+    {
+      Error_ = Error;
+    }
+  }
+  for (unsigned i = 0; i < Size(); ++i)
+  {
+    std::lock_guard<std::mutex> range(Ranges_[i].Lock);
+    Ranges_[i].Next = Ranges_[i].End;
+  }
+}
+
+//Pops the next task index from the front of the worker's own range.
+bool ThreadPool::TakeTask(unsigned Worker, unsigned& Task)
+{
+  std::lock_guard<std::mutex> guard(Ranges_[Worker].Lock);
+  if (Failed_ || Ranges_[Worker].Next == Ranges_[Worker].End)
+  {
+    return false;
+  }
+  Task = Ranges_[Worker].Next++;
+  return true;
+}
+
+//Moves the back half of some other worker's range into this worker's.
+bool ThreadPool::Steal(unsigned Worker)
+{
+  for (unsigned Offset = 1; Offset < Size(); ++Offset)
+  {
+    TaskRange& Victim = Ranges_[(Worker + Offset) % Size()];
+    unsigned Begin;
+    unsigned End;
+    {
+      std::lock_guard<std::mutex> guard(Victim.Lock);
+      unsigned Remaining = Victim.End - Victim.Next;
+      if (Remaining == 0)
+      {
+        continue;
+      }
+      End = Victim.End;
+      Victim.End -= (Remaining + 1) / 2;
+      Begin = Victim.End;
+    }
+    std::lock_guard<std::mutex> guard(Ranges_[Worker].Lock);
+    //A failure between the two locks has already emptied every range;
+    //the stolen tasks are dropped rather than run.
+    if (Failed_)
+    {
+      return false;
+    }
+    Ranges_[Worker].Next = Begin;
+    Ranges_[Worker].End = End;
+    return true;
+  }
+  return false;
+}
+
+//Body of every background thread: sleep until a new job arrives, then help.
+void ThreadPool::WorkerLoop(unsigned Worker)
+{
+  unsigned SeenGeneration = 0;
+  while (true)
+  {
+    {
+      std::unique_lock<std::mutex> guard(Lock_);
+      WakeUp_.wait(guard, [&] { return Stopping_ || Generation_ != SeenGeneration; });
+      if (Stopping_)
+      {
+        return;
+      }
+      SeenGeneration = Generation_;
+    }
+
+    Drain(Worker);
+
+    std::lock_guard<std::mutex> guard(Lock_);
+    if (--Busy_ == 0)
+    {
+      Finished_.notify_one();
+    }
+  }
+}
@@ -0,0 +1,64 @@
+/**********************************************************************/
+/*! \file  ThreadPool.h
+ * \author Seth Peterson
+ * \date   2020-09-20
+ * \brief
+ *     A small fixed pool of worker threads used by the parallel
+ *     projection engines. Tasks are balanced by work stealing.
+ */
+/**********************************************************************/
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <atomic> //Failed flag read outside the job lock
+#include <condition_variable> //For waking and waiting on workers
+#include <exception> //Carries a task's exception back to Run
+#include <functional> //For the task callback
+#include <memory> //Owns the per-worker task ranges
+#include <mutex> //Guards the job handoff
+#include <thread> //Worker threads
+#include <vector> //Holds the workers
+
+class ThreadPool
+{
+  private:
+    //Remaining task indices [Next, End) of one worker. Owners take from the
+    //front, thieves split off the back half.
+    struct alignas(64) TaskRange
+    {
+      std::mutex Lock;
+      unsigned Next = 0;
+      unsigned End = 0;
+    };
+
+    std::vector<std::thread> Workers_;
+    std::unique_ptr<TaskRange[]> Ranges_;
+    std::mutex Lock_;
+    std::condition_variable WakeUp_;
+    std::condition_variable Finished_;
+
+    const std::function<void(unsigned, unsigned)>* Job_ = nullptr;
+    unsigned Generation_ = 0;
+    unsigned Busy_ = 0;
+    bool Stopping_ = false;
+    std::exception_ptr Error_;
+    std::atomic<bool> Failed_{false};
+
+    void WorkerLoop(unsigned Worker);
+    void Drain(unsigned Worker);
+    bool TakeTask(unsigned Worker, unsigned& Task);
+    bool Steal(unsigned Worker);
+    void Fail(std::exception_ptr Error);
+
+  public:
+    ThreadPool(unsigned Threads = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    unsigned Size() const;
+    void Run(unsigned Tasks, const std::function<void(unsigned Task, unsigned Worker)>& Work);
+};
+
+#endif
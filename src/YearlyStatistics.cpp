@@ -0,0 +1,101 @@
+/**********************************************************************/
+/*! \file  YearlyStatistics.cpp
+ * \author Seth Peterson
+ * \date   2020-10-12
+ * \brief
+ *     Sharded per year statistics. Rows land in the shard of the thread
+ *     that computed them; the shards are merged once at the end.
+ */
+/**********************************************************************/
+#include "YearlyStatistics.h"
+#include "InvestmentCalculator.h" //Projections to aggregate
+#include "ThreadPool.h" //Workers for AggregateYearly
+#include <stdexcept> //For a bad shard count
+
+//Adds the row's balance to the accumulator of its year.
+void YearlyStatistics::ShardSink::Row(const HistoryRow& Row)
+{
+  if (Row.Year < 0)
+  {
+    return;
+  }
+  size_t Year = static_cast<size_t>(Row.Year);
+  if (Year >= Years.size())
+  {
+    Years.resize(Year + 1);
+  }
+  Years[Year].Add(Row.Total);
+}
+
+/*! \brief
+ * \param Shards
+ * Number of threads that will feed rows at the same time, usually the
+ * size of the pool the projections run on.
+ */
+YearlyStatistics::YearlyStatistics(unsigned Shards) :
+  Shards_(Shards)
+{
+  if (Shards == 0)
+  {
+    throw std::invalid_argument("Yearly statistics need at least one shard.");
+  }
+}
+
+unsigned YearlyStatistics::Shards()
+{
+  return static_cast<unsigned>(Shards_.size());
+}
+
+/*! \brief
+ * Sink for one thread to pass to PredictGrowth. Only that thread may feed
+ * it until Merge.
+ */
+HistorySink& YearlyStatistics::Sink(unsigned Shard)
+{
+  return Shards_.at(Shard).Sink;
+}
+
+/*! \brief
+ * Combines every shard.
+ * \return
+ * Balance statistics indexed by year label. Years no row was labelled
+ * with (between EveryNth rows, for instance) have a count of zero.
+ */
+std::vector<RunningStatistics> YearlyStatistics::Merge()
+{
+  std::vector<RunningStatistics> Years;
+  for (const Shard& Part : Shards_)
+  {
+    if (Part.Sink.Years.size() > Years.size())
+    {
+      Years.resize(Part.Sink.Years.size());
+    }
+    for (size_t Year = 0; Year < Part.Sink.Years.size(); ++Year)
+    {
+      Years[Year].Merge(Part.Sink.Years[Year]);
+    }
+  }
+  return Years;
+}
+
+/*! \brief
+ * Projects every account on the pool and gathers per year balance
+ * statistics across them, without keeping any account's history.
+ * \param Accounts
+ * Calculators to project; each is projected by exactly one worker.
+ * \param Years
+ * Years to project every account.
+ * \param Pool
+ * Workers to spread the accounts over.
+ * \return
+ * See YearlyStatistics::Merge.
+ */
+std::vector<RunningStatistics> AggregateYearly(std::vector<InvestmentCalculator>& Accounts, unsigned Years, ThreadPool& Pool)
+{
+  YearlyStatistics Statistics(Pool.Size());
+  Pool.Run(static_cast<unsigned>(Accounts.size()), [&](unsigned Account, unsigned Worker)
+  {
+    Accounts[Account].PredictGrowth(Years, Statistics.Sink(Worker));
+  });
+  return Statistics.Merge();
+}
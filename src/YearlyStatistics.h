@@ -0,0 +1,51 @@
+/**********************************************************************/
+/*! \file  YearlyStatistics.h
+ * \author Seth Peterson
+ * \date   2020-10-12
+ * \brief
+ *     Year by year balance statistics over many projections, gathered
+ *     straight from PredictGrowth without storing any history.
+ */
+/**********************************************************************/
+#ifndef YEARLYSTATISTICS_H
+#define YEARLYSTATISTICS_H
+
+#include "HistorySink.h" //Shards receive rows as a sink
+#include "RunningStatistics.h" //Per year accumulators
+#include <vector> //Shards and years
+
+class InvestmentCalculator;
+class ThreadPool;
+
+/* One shard per thread. Each shard is a sink that keeps a Welford
+ * accumulator of the balance for every year label it has seen, so
+ * threads never share anything until Merge combines the shards. */
+class YearlyStatistics
+{
+  private:
+    class ShardSink : public HistorySink
+    {
+      public:
+        std::vector<RunningStatistics> Years;
+        void Row(const HistoryRow& Row) override;
+    };
+
+    //Own cache lines, so neighbouring shards do not falsely share.
+    struct alignas(64) Shard
+    {
+      ShardSink Sink;
+    };
+
+    std::vector<Shard> Shards_;
+
+  public:
+    YearlyStatistics(unsigned Shards);
+
+    unsigned Shards();
+    HistorySink& Sink(unsigned Shard);
+    std::vector<RunningStatistics> Merge();
+};
+
+std::vector<RunningStatistics> AggregateYearly(std::vector<InvestmentCalculator>& Accounts, unsigned Years, ThreadPool& Pool);
+
+#endif